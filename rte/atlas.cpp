@@ -0,0 +1,212 @@
+/*============*\
+| ATLAS SOURCE |
+\*============*/
+
+#include "main.h"
+#include "global.h"
+#include "graphics.h"
+#include "batch.h"
+#include "renderstate.h"
+#include "atlas.h"
+
+//Pages are packed with a skyline: the top
+//edge of everything placed so far is kept as
+//a list of horizontal segments, and each new
+//sheet goes wherever it ends up lowest.
+
+struct xyAtlasSpan{
+	int x, y, w;
+};
+
+struct xyAtlasPage{
+	Uint32 tex;					//Handle in vcTextures
+	vector<xyAtlasSpan> sky;	//Skyline, left to right
+	Uint32 users;				//Sprites packed into this page
+};
+
+Uint32 gvAtlasMaxSheet = 512;
+static vector<xyAtlasPage> vcPages;
+static int atlasSize = 0;
+static const int atlasGap = 1; //Keeps filtering from bleeding between sheets
+
+//Pick a page size the renderer can handle
+static int xyAtlasSize(){
+	if(atlasSize > 0) return atlasSize;
+
+	atlasSize = 2048;
+	SDL_RendererInfo info;
+	if(SDL_GetRendererInfo(gvRender, &info) == 0){
+		if(info.max_texture_width > 0 && info.max_texture_width < atlasSize) atlasSize = info.max_texture_width;
+		if(info.max_texture_height > 0 && info.max_texture_height < atlasSize) atlasSize = info.max_texture_height;
+	};
+
+	return atlasSize;
+};
+
+//Find the lowest spot for a w*h rectangle,
+//returns the skyline index it starts at or -1
+static int xyAtlasFit(xyAtlasPage& page, int w, int h, int* outY){
+	int best = -1;
+	int bestY = atlasSize, bestW = atlasSize;
+
+	for(int i = 0; i < page.sky.size(); i++){
+		int x = page.sky[i].x;
+		if(x + w > atlasSize) break;
+
+		//Rest on the highest segment underneath
+		int y = 0;
+		int left = w;
+		for(int j = i; j < page.sky.size() && left > 0; j++){
+			if(page.sky[j].y > y) y = page.sky[j].y;
+			left -= page.sky[j].w;
+		};
+		if(y + h > atlasSize) continue;
+
+		//Prefer the lowest spot, then the tightest one
+		if(y < bestY || (y == bestY && page.sky[i].w < bestW)){
+			best = i;
+			bestY = y;
+			bestW = page.sky[i].w;
+		};
+	};
+
+	*outY = bestY;
+	return best;
+};
+
+//Raise the skyline over a newly placed rectangle
+static void xyAtlasPlace(xyAtlasPage& page, int i, int w, int h, int y){
+	xyAtlasSpan span;
+	span.x = page.sky[i].x;
+	span.y = y + h;
+	span.w = w;
+	page.sky.insert(page.sky.begin() + i, span);
+
+	//Trim or remove the segments now covered
+	int right = span.x + span.w;
+	for(int j = i + 1; j < page.sky.size();){
+		if(page.sky[j].x >= right) break;
+
+		int over = right - page.sky[j].x;
+		if(over >= page.sky[j].w){
+			page.sky.erase(page.sky.begin() + j);
+		} else {
+			page.sky[j].x += over;
+			page.sky[j].w -= over;
+			break;
+		};
+	};
+
+	//Merge neighbours at the same height
+	for(int j = 0; j + 1 < page.sky.size();){
+		if(page.sky[j].y == page.sky[j + 1].y){
+			page.sky[j].w += page.sky[j + 1].w;
+			page.sky.erase(page.sky.begin() + j + 1);
+		} else j++;
+	};
+};
+
+//Make a page fully transparent, so nothing left
+//over shows through gaps or under smaller sheets
+static void xyAtlasClear(SDL_Texture* tex){
+	if(tex == 0) return;
+
+	vector<Uint32> blank(atlasSize * atlasSize, 0);
+	xyBatchForget(tex);
+	SDL_UpdateTexture(tex, 0, &blank[0], atlasSize * 4);
+};
+
+static void xyAtlasReset(xyAtlasPage& page){
+	xyAtlasSpan span;
+	span.x = 0;
+	span.y = 0;
+	span.w = atlasSize;
+
+	page.sky.clear();
+	page.sky.push_back(span);
+	page.users = 0;
+};
+
+//Copy a sheet loaded with xyLoadSurface() into an
+//atlas page. Returns false if the sheet should get
+//its own texture instead, either because packing is
+//off or the sheet is too big.
+bool xyAtlasPack(SDL_Surface* sheet, Uint32* tex, int* x, int* y){
+	if(sheet == 0 || gvAtlasMaxSheet == 0) return false;
+	if((Uint32)sheet->w > gvAtlasMaxSheet || (Uint32)sheet->h > gvAtlasMaxSheet) return false;
+
+	int size = xyAtlasSize();
+	int w = sheet->w + atlasGap;
+	int h = sheet->h + atlasGap;
+	if(w > size || h > size) return false;
+
+	//Look for room on an existing page
+	int page = -1, spot = -1, top = 0;
+	for(int i = 0; i < vcPages.size(); i++){
+		spot = xyAtlasFit(vcPages[i], w, h, &top);
+		if(spot != -1){
+			page = i;
+			break;
+		};
+	};
+
+	//Otherwise start a new one
+	if(page == -1){
+		SDL_Texture* ntex = SDL_CreateTexture(gvRender, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, size, size);
+		if(ntex == 0){
+			xyPrint(0, "Unable to create atlas page! SDL Error: %s\n", SDL_GetError());
+			return false;
+		};
+
+		xyAtlasClear(ntex);
+
+		xyAtlasPage npage;
+		npage.tex = xyAddTexture(ntex);
+		xyAtlasReset(npage);
+		vcPages.push_back(npage);
+
+		page = vcPages.size() - 1;
+		spot = xyAtlasFit(vcPages[page], w, h, &top);
+		if(spot == -1) return false;
+	};
+
+	xyAtlasPage& p = vcPages[page];
+	SDL_Rect dest;
+	dest.x = p.sky[spot].x;
+	dest.y = top;
+	dest.w = sheet->w;
+	dest.h = sheet->h;
+
+	//Anything already queued from this page must go out first
+	xyBatchForget(vcTextures[p.tex]);
+	SDL_LockSurface(sheet);
+	SDL_UpdateTexture(vcTextures[p.tex], &dest, sheet->pixels, sheet->pitch);
+	SDL_UnlockSurface(sheet);
+
+	xyAtlasPlace(p, spot, w, h, top);
+	p.users++;
+
+	*tex = p.tex;
+	*x = dest.x;
+	*y = dest.y;
+	return true;
+};
+
+//A sprite no longer needs its spot. Space on a page
+//is only reclaimed once every sprite on it is gone.
+void xyAtlasRelease(Uint32 tex){
+	for(int i = 0; i < vcPages.size(); i++){
+		if(vcPages[i].tex != tex) continue;
+
+		if(vcPages[i].users > 0) vcPages[i].users--;
+		if(vcPages[i].users == 0){
+			xyAtlasReset(vcPages[i]);
+			xyAtlasClear(vcTextures[tex]);
+		};
+		return;
+	};
+};
+
+Uint32 xyAtlasPages(){
+	return vcPages.size();
+};
@@ -0,0 +1,25 @@
+/*============*\
+| ATLAS HEADER |
+\*============*/
+
+#ifndef _ATLAS_H_
+#define _ATLAS_H_
+
+#include "main.h"
+
+//Sprite sheets are packed into a few large
+//atlas pages when they are loaded so sprites
+//from different sheets share a texture and
+//can be drawn in the same batch.
+//
+//Pages are kept in vcTextures like any other
+//image. A sprite only remembers which page it
+//is on and where its sheet starts.
+
+extern Uint32 gvAtlasMaxSheet;		//Largest sheet side to pack, 0 disables packing
+
+bool xyAtlasPack(SDL_Surface* sheet, Uint32* tex, int* x, int* y);
+void xyAtlasRelease(Uint32 tex);
+Uint32 xyAtlasPages();
+
+#endif
@@ -5,80 +5,86 @@
 #include "main.h"
 #include "global.h"
 #include "audio.h"
+#include "pak.h"
+#include "cache.h"
 
 Uint32 xyLoadSound(const char* filename){
+	//Share a sound that is already loaded
+	string key = xyCacheKey(filename);
+	Uint32 hit = xyCacheGet(_LK_SOUND, key);
+	if(hit != 0) return hit;
+
 	//Load the sound file
-	Mix_Chunk* newSnd = Mix_LoadWAV(filename);
+	Mix_Chunk* newSnd = Mix_LoadWAV_RW(xyOpenAsset(filename), 1);
 	if(newSnd == 0){
 		xyPrint(0, "Failed to load %s! SDL_Mixer Error: %s\n", filename, Mix_GetError());
+		return xyAddSound(newSnd);
 	};
 
-	//Add the file to the list
-	if(vcSounds.size() == 0){
-		vcSounds.push_back(newSnd);
-		return 0;
-	} else {
-		//Check for an open space in the list
-		for(int i = 1; i < vcSounds.size(); i++){
-			if(vcSounds[i] == 0){
-				vcSounds[i] = newSnd;
-				return i;
-				break;
-			};
-		};
-	};
+	Uint32 snd = xyAddSound(newSnd);
+	xyCachePut(_LK_SOUND, key, snd);
+	return snd;
+};
 
-	//If an open space wasn't found
-	vcSounds.push_back(newSnd);
-	return vcSounds.size() - 1;
+//Assign a sound to a free slot in the sounds list
+Uint32 xyAddSound(Mix_Chunk* newSnd){
+	return vcSounds.add(newSnd);
 };
 
 Uint32 xyLoadMusic(const char* filename){
+	//Share music that is already loaded
+	string key = xyCacheKey(filename);
+	Uint32 hit = xyCacheGet(_LK_MUSIC, key);
+	if(hit != 0) return hit;
+
 	//Load the music file
-	Mix_Music* newMsc = Mix_LoadMUS(filename);
+	Mix_Music* newMsc = Mix_LoadMUS_RW(xyOpenAsset(filename), 1);
 	if(newMsc == 0){
 		xyPrint(0, "Failed to load %s! SDL_Mixer Error: %s\n", filename, Mix_GetError());
+		return xyAddMusic(newMsc);
 	};
 
-	//Add the file to the list
-	if(vcMusic.size() == 0){
-		vcMusic.push_back(newMsc);
-		return 0;
-	} else {
-		//Check for an open space in the list
-		for(int i = 1; i < vcMusic.size(); i++){
-			if(vcMusic[i] == 0){
-				vcMusic[i] = newMsc;
-				return i;
-				break;
-			};
-		};
-	};
+	Uint32 msc = xyAddMusic(newMsc);
+	xyCachePut(_LK_MUSIC, key, msc);
+	return msc;
+};
 
-	//If an open space wasn't found
-	vcMusic.push_back(newMsc);
-	return vcMusic.size() - 1;
+//Assign music to a free slot in the music list
+Uint32 xyAddMusic(Mix_Music* newMsc){
+	return vcMusic.add(newMsc);
 };
 
 void xyDeleteSound(Uint32 sound){
-	if(sound >= vcSounds.size()) return;
 	if(vcSounds[sound] == 0) return;
+	if(!xyCacheDrop(_LK_SOUND, sound)) return;
 	Mix_FreeChunk(vcSounds[sound]);
+	vcSounds.remove(sound);
 };
 
 void xyDeleteMusic(Uint32 music){
-	if(music >= vcMusic.size()) return;
 	if(vcMusic[music] == 0) return;
+	if(!xyCacheDrop(_LK_MUSIC, music)) return;
 	Mix_FreeMusic(vcMusic[music]);
+	vcMusic.remove(music);
 };
 
 int xyPlaySound(Uint32 sound, Uint32 loops){
+	if(vcSounds[sound] == 0){
+		xyPrint(0, "Sound %u does not exist!", sound);
+		return -1;
+	};
+
 	int i = Mix_PlayChannel(-1, vcSounds[sound], loops);
 	if(i == -1) xyPrint(0, "Error playing sound! SDL_Mixer Error: %s\n", Mix_GetError());
 	return i;
 };
 
 int xyPlayMusic(Uint32 music, Uint32 loops){
+	if(vcMusic[music] == 0){
+		xyPrint(0, "Music %u does not exist!", music);
+		return -1;
+	};
+
 	int i = Mix_PlayMusic(vcMusic[music], loops);
 	if(i == -1) xyPrint(0, "Error playing music! SDL_Mixer Error: %s\n", Mix_GetError());
 	return i;
@@ -7,6 +7,8 @@
 
 Uint32 xyLoadSound(const char* filename);
 Uint32 xyLoadMusic(const char* filename);
+Uint32 xyAddSound(Mix_Chunk* newSnd);
+Uint32 xyAddMusic(Mix_Music* newMsc);
 void xyDeleteSound(Uint32 sound);
 void xyDeleteMusic(Uint32 music);
 int xyPlaySound(Uint32 sound, Uint32 loops);
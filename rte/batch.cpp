@@ -0,0 +1,534 @@
+/*============*\
+| BATCH SOURCE |
+\*============*/
+
+#include "main.h"
+#include "global.h"
+#include "graphics.h"
+#include "batch.h"
+#include "renderstate.h"
+#include "capture.h"
+
+//Draw calls are first recorded as commands with
+//a sort key, then sorted and merged into batches
+//when the list is flushed. The key is, from the
+//top bits down: layer, depth, texture and the
+//order the command was recorded in, so anything
+//drawn at the same layer and depth still comes
+//out in call order unless texture sorting is on.
+
+struct xyDrawCmd{
+	Uint64 key;
+	SDL_Texture* tex;
+	SDL_BlendMode blend;
+	Uint32 vfirst, vcount;	//Vertices in cVerts
+	Uint32 ifirst, icount;	//Indices in cIndices, relative to vfirst
+	Uint32 quads;
+};
+
+//Recorded commands. The buffers are kept between
+//frames so they only grow until they reach the
+//size of the busiest frame.
+static vector<xyDrawCmd> cCmds;
+static vector<SDL_Vertex> cVerts;
+static vector<int> cIndices;
+static vector<SDL_Texture*> cTexs;	//Textures used by the list, in the order they showed up
+static vector<Uint32> cOrder, cSwap;	//Command indices for sorting
+
+//Commands set aside while the engine bakes into
+//a texture of its own, so the target it was drawing
+//to is still sorted as a whole once it's flushed
+struct xyBatchSaved{
+	vector<xyDrawCmd> cmds;
+	vector<SDL_Vertex> verts;
+	vector<int> indices;
+	vector<SDL_Texture*> texs;
+};
+static vector<xyBatchSaved> cSaved;
+
+//Key of the commands being recorded
+static int cLayer = 0;
+static int cDepth = 0;
+static bool cTexSort = 0;
+
+//Vertices waiting to be submitted while the
+//sorted commands are being replayed
+static vector<SDL_Vertex> bVerts;
+static vector<int> bIndices;
+static Uint32 bQuads = 0;
+
+//Texture and blend mode of the current batch
+static SDL_Texture* bTex = 0;
+static SDL_BlendMode bBlend = SDL_BLENDMODE_BLEND;	//Used by new commands
+static SDL_BlendMode bSubmit = SDL_BLENDMODE_BLEND;	//Used by the batch being replayed
+
+//Size of the last texture quads were mapped onto
+static SDL_Texture* rTex = 0;
+static float rTexW = 1, rTexH = 1;
+
+//Counters for this frame and the last finished one
+static xyBatchStats bStats = {0, 0, 0, 0, 0, 0, 0};
+static xyBatchStats bLast = {0, 0, 0, 0, 0, 0, 0};
+
+//Size is only needed to turn pixels into UVs
+static void xyBatchMeasure(SDL_Texture* tex){
+	if(tex == rTex) return;
+
+	int w = 1, h = 1;
+	SDL_QueryTexture(tex, 0, 0, &w, &h);
+	rTex = tex;
+	rTexW = (w > 0 ? w : 1);
+	rTexH = (h > 0 ? h : 1);
+};
+
+//Small number standing for a texture in the sort key
+static Uint32 xyBatchTexRank(SDL_Texture* tex){
+	if(!cTexSort) return 0;
+
+	for(int i = cTexs.size() - 1; i >= 0; i--){
+		if(cTexs[i] == tex) return i & 0xFFFF;
+	};
+
+	cTexs.push_back(tex);
+	return (cTexs.size() - 1) & 0xFFFF;
+};
+
+//Start a command for vcount new vertices, or keep
+//adding to the last one if nothing about it differs
+static xyDrawCmd* xyBatchCommand(SDL_Texture* tex, Uint32 vcount){
+	//The order only has room for 24 bits
+	if(cCmds.size() >= 0xFFFFFF) xyBatchFlush();
+
+	int layer = cLayer + 128;
+	if(layer < 0) layer = 0;
+	if(layer > 0xFF) layer = 0xFF;
+
+	int depth = cDepth + 32768;
+	if(depth < 0) depth = 0;
+	if(depth > 0xFFFF) depth = 0xFFFF;
+
+	Uint64 key = ((Uint64)layer << 56) | ((Uint64)depth << 40) | ((Uint64)xyBatchTexRank(tex) << 24);
+
+	if(cCmds.size() > 0){
+		xyDrawCmd& last = cCmds.back();
+		if(last.tex == tex && last.blend == bBlend && (last.key & 0xFFFFFFFFFF000000ULL) == key){
+			last.vcount += vcount;
+			return &last;
+		};
+	};
+
+	xyDrawCmd cmd;
+	cmd.key = key | cCmds.size();
+	cmd.tex = tex;
+	cmd.blend = bBlend;
+	cmd.vfirst = cVerts.size();
+	cmd.vcount = vcount;
+	cmd.ifirst = cIndices.size();
+	cmd.icount = 0;
+	cmd.quads = 0;
+	cCmds.push_back(cmd);
+
+	return &cCmds.back();
+};
+
+//Append four corners and the two triangles joining them,
+//unless the camera can't see any of them
+static void xyBatchPush(SDL_Texture* tex, SDL_FPoint* p, float u0, float v0, float u1, float v1, Uint8 alpha){
+	if(!xyCameraPlace(p, 4)){
+		bStats.culled++;
+		return;
+	};
+	bStats.drawn++;
+
+	xyDrawCmd* cmd = xyBatchCommand(tex, 4);
+	int first = cVerts.size() - cmd->vfirst;
+	SDL_Color white = {0xFF, 0xFF, 0xFF, alpha};
+
+	SDL_Vertex vert;
+	vert.color = white;
+
+	vert.position = p[0]; vert.tex_coord.x = u0; vert.tex_coord.y = v0;
+	cVerts.push_back(vert);
+	vert.position = p[1]; vert.tex_coord.x = u1; vert.tex_coord.y = v0;
+	cVerts.push_back(vert);
+	vert.position = p[2]; vert.tex_coord.x = u1; vert.tex_coord.y = v1;
+	cVerts.push_back(vert);
+	vert.position = p[3]; vert.tex_coord.x = u0; vert.tex_coord.y = v1;
+	cVerts.push_back(vert);
+
+	cIndices.push_back(first);
+	cIndices.push_back(first + 1);
+	cIndices.push_back(first + 2);
+	cIndices.push_back(first + 2);
+	cIndices.push_back(first + 3);
+	cIndices.push_back(first);
+
+	cmd->icount += 6;
+	cmd->quads++;
+	bStats.quads++;
+};
+
+//Queue a texture region without rotation or flipping.
+//A null source rectangle uses the whole texture.
+void xyBatchQuad(SDL_Texture* tex, const SDL_Rect* src, const SDL_FRect* des){
+	if(tex == 0) return;
+	xyBatchMeasure(tex);
+
+	float u0 = 0, v0 = 0, u1 = 1, v1 = 1;
+	if(src != 0){
+		u0 = src->x / rTexW;
+		v0 = src->y / rTexH;
+		u1 = (src->x + src->w) / rTexW;
+		v1 = (src->y + src->h) / rTexH;
+	};
+
+	SDL_FPoint p[4];
+	p[0].x = des->x; p[0].y = des->y;
+	p[1].x = des->x + des->w; p[1].y = des->y;
+	p[2].x = des->x + des->w; p[2].y = des->y + des->h;
+	p[3].x = des->x; p[3].y = des->y + des->h;
+
+	xyBatchPush(tex, p, u0, v0, u1, v1, 0xFF);
+};
+
+//Baking onto a clear target leaves colors already multiplied
+//by their alpha, so blending them by alpha again would darken
+//soft edges. Multiplying works out the same either way.
+static SDL_BlendMode xyBatchPremultiplied(SDL_BlendMode mode){
+	if(mode == SDL_BLENDMODE_BLEND) return SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+	if(mode == SDL_BLENDMODE_ADD) return SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE, SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ZERO, SDL_BLENDFACTOR_ONE, SDL_BLENDOPERATION_ADD);
+	if(mode == xyStateBlendMode(2)) return SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE, SDL_BLENDOPERATION_REV_SUBTRACT, SDL_BLENDFACTOR_ZERO, SDL_BLENDFACTOR_ONE, SDL_BLENDOPERATION_ADD);
+	return mode;
+};
+
+//Queue a whole texture the engine baked itself,
+//with the blend mode the script set
+void xyBatchBaked(SDL_Texture* tex, const SDL_FRect* des){
+	SDL_BlendMode blend = bBlend;
+	bBlend = xyBatchPremultiplied(blend);
+	xyBatchQuad(tex, 0, des);
+	bBlend = blend;
+};
+
+//Queue a texture region the same way SDL_RenderCopyEx()
+//would draw it: rotated clockwise by angle degrees around
+//piv, which is relative to the destination's corner. The
+//alpha is put in the vertex colors, so quads with different
+//alpha values still share a batch.
+void xyBatchQuadEx(SDL_Texture* tex, const SDL_Rect* src, const SDL_FRect* des, double angle, const SDL_FPoint* piv, SDL_RendererFlip flip, Uint8 alpha){
+	if(tex == 0) return;
+	xyBatchMeasure(tex);
+
+	float u0 = 0, v0 = 0, u1 = 1, v1 = 1;
+	if(src != 0){
+		u0 = src->x / rTexW;
+		v0 = src->y / rTexH;
+		u1 = (src->x + src->w) / rTexW;
+		v1 = (src->y + src->h) / rTexH;
+	};
+
+	//Flipping just swaps texture coordinates
+	if(flip & SDL_FLIP_HORIZONTAL) swap(u0, u1);
+	if(flip & SDL_FLIP_VERTICAL) swap(v0, v1);
+
+	//Pivot defaults to the center like SDL
+	float cx = des->w / 2, cy = des->h / 2;
+	if(piv != 0){
+		cx = piv->x;
+		cy = piv->y;
+	};
+
+	float c = 1, s = 0;
+	if(angle != 0){
+		double rad = angle * (pi / 180.0);
+		c = cos(rad);
+		s = sin(rad);
+	};
+
+	//Corners relative to the pivot
+	float lx[4] = {-cx, des->w - cx, des->w - cx, -cx};
+	float ly[4] = {-cy, -cy, des->h - cy, des->h - cy};
+
+	SDL_FPoint p[4];
+	for(int i = 0; i < 4; i++){
+		p[i].x = des->x + cx + (lx[i] * c) - (ly[i] * s);
+		p[i].y = des->y + cy + (lx[i] * s) + (ly[i] * c);
+	};
+
+	xyBatchPush(tex, p, u0, v0, u1, v1, alpha);
+};
+
+//Queue quads that were laid out ahead of time, four
+//vertices each with UVs already set, moved by x and y.
+//Used by cached text so it doesn't have to redo its
+//layout every frame.
+void xyBatchVerts(SDL_Texture* tex, const SDL_Vertex* verts, Uint32 quads, float x, float y){
+	if(tex == 0 || quads == 0) return;
+
+	xyDrawCmd* cmd = xyBatchCommand(tex, 0);
+	cVerts.reserve(cVerts.size() + (quads * 4));
+	cIndices.reserve(cIndices.size() + (quads * 6));
+
+	SDL_FPoint p[4];
+	for(Uint32 i = 0; i < quads; i++){
+		const SDL_Vertex* q = verts + (i * 4);
+		for(int j = 0; j < 4; j++){
+			p[j].x = q[j].position.x + x;
+			p[j].y = q[j].position.y + y;
+		};
+
+		if(!xyCameraPlace(p, 4)){
+			bStats.culled++;
+			continue;
+		};
+		bStats.drawn++;
+
+		int first = cVerts.size() - cmd->vfirst;
+		for(int j = 0; j < 4; j++){
+			SDL_Vertex vert = q[j];
+			vert.position = p[j];
+			cVerts.push_back(vert);
+		};
+
+		cIndices.push_back(first);
+		cIndices.push_back(first + 1);
+		cIndices.push_back(first + 2);
+		cIndices.push_back(first + 2);
+		cIndices.push_back(first + 3);
+		cIndices.push_back(first);
+
+		cmd->vcount += 4;
+		cmd->icount += 6;
+		cmd->quads++;
+		bStats.quads++;
+	};
+
+	//Everything was culled
+	if(cmd->icount == 0) cCmds.pop_back();
+};
+
+//Queue untextured triangles in one color. Indices
+//are relative to the first of the given points.
+void xyBatchShape(const SDL_FPoint* pts, Uint32 npts, const int* idx, Uint32 nidx, SDL_Color color){
+	static vector<SDL_FPoint> placed;
+	if(npts == 0 || nidx == 0) return;
+
+	placed.assign(pts, pts + npts);
+	if(!xyCameraPlace(&placed[0], npts)){
+		bStats.culled++;
+		return;
+	};
+	bStats.drawn++;
+
+	xyDrawCmd* cmd = xyBatchCommand(0, npts);
+	int first = cVerts.size() - cmd->vfirst;
+
+	SDL_Vertex vert;
+	vert.color = color;
+	vert.tex_coord.x = 0;
+	vert.tex_coord.y = 0;
+
+	for(Uint32 i = 0; i < npts; i++){
+		vert.position = placed[i];
+		cVerts.push_back(vert);
+	};
+
+	for(Uint32 i = 0; i < nidx; i++){
+		cIndices.push_back(first + idx[i]);
+	};
+
+	cmd->icount += nidx;
+	bStats.triangles += nidx / 3;
+};
+
+//Change the blend mode used for the following quads
+void xyBatchSetBlend(SDL_BlendMode mode){
+	bBlend = mode;
+};
+
+SDL_BlendMode xyBatchGetBlend(){
+	return bBlend;
+};
+
+//Layer and depth of everything drawn from now on.
+//Higher values are drawn on top.
+void xyBatchSetLayer(int layer){
+	cLayer = layer;
+};
+
+void xyBatchSetDepth(int depth){
+	cDepth = depth;
+};
+
+//Also group commands at the same layer and depth by
+//texture. This merges more draws into each batch,
+//but overlapping sprites may swap places.
+void xyBatchSetTextureSort(bool sort){
+	if(sort == cTexSort) return;
+
+	xyBatchFlush();
+	cTexSort = sort;
+};
+
+//Send the vertices gathered while replaying
+static void xyBatchSubmit(){
+	if(bIndices.size() == 0) return;
+
+	//Shapes take the renderer's blend mode instead
+	if(bTex != 0) xyStateTextureBlend(bTex, bSubmit);
+	else xyStateBlend(bSubmit);
+	//Headless frames are only rasterized when they are being recorded.
+	//Textures baked by the engine are always drawn, since they are
+	//marked clean and kept for later frames that may be recorded.
+	bool screen = (xyStateGetTarget() == gvScreen);
+	if(!gvHeadless || xyCapturing() || !screen) SDL_RenderGeometry(gvRender, bTex, &bVerts[0], bVerts.size(), &bIndices[0], bIndices.size());
+
+	//Record how much this submission saved
+	bStats.flushes++;
+	bStats.merged.push_back(bQuads);
+	if(bQuads > bStats.largest) bStats.largest = bQuads;
+
+	bVerts.clear();
+	bIndices.clear();
+	bQuads = 0;
+};
+
+//Put the commands in key order with an LSD radix sort,
+//one byte at a time. Bytes that are the same in every
+//key are skipped, which is most of them when scripts
+//only use a few layers and depths.
+static void xyBatchSort(){
+	Uint32 n = cCmds.size();
+	cOrder.resize(n);
+	cSwap.resize(n);
+	for(Uint32 i = 0; i < n; i++) cOrder[i] = i;
+
+	//The order is already sorted when nothing else is set
+	bool sorted = 1;
+	for(Uint32 i = 1; i < n && sorted; i++){
+		if(cCmds[i].key < cCmds[i - 1].key) sorted = 0;
+	};
+	if(sorted) return;
+
+	for(int shift = 0; shift < 64; shift += 8){
+		Uint32 count[256] = {0};
+		for(Uint32 i = 0; i < n; i++) count[(cCmds[cOrder[i]].key >> shift) & 0xFF]++;
+
+		//Nothing to do if every key has the same byte here
+		if(count[(cCmds[0].key >> shift) & 0xFF] == n) continue;
+
+		Uint32 total = 0;
+		for(int b = 0; b < 256; b++){
+			Uint32 c = count[b];
+			count[b] = total;
+			total += c;
+		};
+
+		for(Uint32 i = 0; i < n; i++){
+			Uint32 c = cOrder[i];
+			cSwap[count[(cCmds[c].key >> shift) & 0xFF]++] = c;
+		};
+		cOrder.swap(cSwap);
+	};
+};
+
+//Sort everything recorded so far and submit it
+void xyBatchFlush(){
+	if(cCmds.size() == 0) return;
+
+	xyBatchSort();
+	bStats.commands += cCmds.size();
+
+	for(Uint32 i = 0; i < cOrder.size(); i++){
+		const xyDrawCmd& cmd = cCmds[cOrder[i]];
+		if(cmd.tex != bTex || cmd.blend != bSubmit){
+			xyBatchSubmit();
+			bTex = cmd.tex;
+			bSubmit = cmd.blend;
+		};
+
+		int base = bVerts.size();
+		bVerts.insert(bVerts.end(), cVerts.begin() + cmd.vfirst, cVerts.begin() + cmd.vfirst + cmd.vcount);
+		for(Uint32 j = 0; j < cmd.icount; j++){
+			bIndices.push_back(base + cIndices[cmd.ifirst + j]);
+		};
+		bQuads += cmd.quads;
+	};
+	xyBatchSubmit();
+
+	cCmds.clear();
+	cVerts.clear();
+	cIndices.clear();
+	cTexs.clear();
+};
+
+//Put what has been recorded so far aside without
+//drawing it, and start an empty list
+void xyBatchSave(){
+	cSaved.push_back(xyBatchSaved());
+	xyBatchSaved& s = cSaved.back();
+	s.cmds.swap(cCmds);
+	s.verts.swap(cVerts);
+	s.indices.swap(cIndices);
+	s.texs.swap(cTexs);
+};
+
+//Flush the list started by xyBatchSave() and go
+//back to the one it set aside
+void xyBatchRestore(){
+	xyBatchFlush();
+	if(cSaved.size() == 0) return;
+
+	xyBatchSaved& s = cSaved.back();
+	cCmds.swap(s.cmds);
+	cVerts.swap(s.verts);
+	cIndices.swap(s.indices);
+	cTexs.swap(s.texs);
+	cSaved.pop_back();
+};
+
+//Make sure a texture about to be destroyed
+//or changed is not still referenced by the batch
+void xyBatchForget(SDL_Texture* tex){
+	for(int i = 0; i < cCmds.size(); i++){
+		if(cCmds[i].tex == tex){
+			xyBatchFlush();
+			break;
+		};
+	};
+
+	if(tex == bTex) bTex = 0;
+	if(tex == rTex) rTex = 0;
+};
+
+//Called once per frame after presenting
+void xyBatchEndFrame(){
+	xyBatchFlush();
+
+	bLast.flushes = bStats.flushes;
+	bLast.quads = bStats.quads;
+	bLast.largest = bStats.largest;
+	bLast.triangles = bStats.triangles;
+	bLast.commands = bStats.commands;
+	bLast.drawn = bStats.drawn;
+	bLast.culled = bStats.culled;
+	bLast.merged.swap(bStats.merged);
+
+	bStats.flushes = 0;
+	bStats.quads = 0;
+	bStats.largest = 0;
+	bStats.triangles = 0;
+	bStats.commands = 0;
+	bStats.drawn = 0;
+	bStats.culled = 0;
+	bStats.merged.clear();
+
+	//Textures may be deleted between frames
+	bTex = 0;
+	rTex = 0;
+};
+
+//Counters from the last finished frame
+const xyBatchStats& xyGetBatchStats(){
+	return bLast;
+};
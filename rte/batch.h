@@ -0,0 +1,69 @@
+/*============*\
+| BATCH HEADER |
+\*============*/
+
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include "main.h"
+
+#if !SDL_VERSION_ATLEAST(2, 0, 18)
+	#error "Brux needs SDL 2.0.18 or newer for SDL_RenderGeometry()"
+#endif
+
+//Sprite batching
+//
+//Textured quads and untextured shapes are
+//recorded into a vertex buffer instead of
+//being sent to SDL one at a time. The buffer
+//is submitted as a single SDL_RenderGeometry()
+//call whenever the texture or blend mode
+//changes, when anything else needs the
+//renderer directly, or at the end of the
+//frame in xyUpdate().
+//
+//Positions are moved by the camera as they
+//are recorded, and anything that ends up
+//completely outside the draw target is
+//dropped right away.
+//
+//Each draw carries a layer and depth set by
+//the script. When the batch is flushed, draws
+//are sorted by those first and only then by
+//the order they were made in.
+//
+//Textures the engine bakes into by itself,
+//like tile chunks and text, set the commands
+//already recorded aside with xyBatchSave()
+//instead of flushing them, so baking never
+//splits a frame into separately sorted parts.
+
+struct xyBatchStats{
+	Uint32 flushes;			//Geometry submissions
+	Uint32 quads;			//Quads recorded
+	Uint32 largest;			//Most quads merged into one submission
+	Uint32 triangles;		//Untextured triangles recorded for shapes
+	Uint32 commands;		//Draw commands sorted before being batched
+	Uint32 drawn;			//Quads and shapes the camera could see
+	Uint32 culled;			//Quads and shapes dropped for being off screen
+	vector<Uint32> merged;	//Quads merged by each submission, in order
+};
+
+void xyBatchQuad(SDL_Texture* tex, const SDL_Rect* src, const SDL_FRect* des);
+void xyBatchQuadEx(SDL_Texture* tex, const SDL_Rect* src, const SDL_FRect* des, double angle, const SDL_FPoint* piv, SDL_RendererFlip flip, Uint8 alpha = 0xFF);
+void xyBatchBaked(SDL_Texture* tex, const SDL_FRect* des);
+void xyBatchVerts(SDL_Texture* tex, const SDL_Vertex* verts, Uint32 quads, float x, float y);
+void xyBatchShape(const SDL_FPoint* pts, Uint32 npts, const int* idx, Uint32 nidx, SDL_Color color);
+void xyBatchSetBlend(SDL_BlendMode mode);
+SDL_BlendMode xyBatchGetBlend();
+void xyBatchSetLayer(int layer);
+void xyBatchSetDepth(int depth);
+void xyBatchSetTextureSort(bool sort);
+void xyBatchFlush();
+void xyBatchSave();
+void xyBatchRestore();
+void xyBatchForget(SDL_Texture* tex);
+void xyBatchEndFrame();
+const xyBatchStats& xyGetBatchStats();
+
+#endif
@@ -356,6 +356,20 @@ const bm_add = 1;
 const bm_sub = 2;
 const bm_mult = 3;
 
+//Screen modes
+const sm_logical = 0;
+const sm_fit = 1;
+const sm_integer = 2;
+
+//Frame pacing modes
+const pm_vsync = 0;
+const pm_sleep = 1;
+const pm_uncapped = 2;
+
+//Capture formats
+const cf_png = 0;
+const cf_y4m = 1;
+
 //Operating System
 const os_windows = 0;
 const os_linux = 1;
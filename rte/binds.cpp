@@ -11,6 +11,15 @@
 #include "text.h"
 #include "audio.h"
 #include "sprite.h"
+#include "batch.h"
+#include "atlas.h"
+#include "primitives.h"
+#include "renderstate.h"
+#include "pacer.h"
+#include "capture.h"
+#include "loader.h"
+#include "pak.h"
+#include "module.h"
 #include "binds.h"
 
 //////////
@@ -33,6 +42,97 @@ SQInteger sqUpdate(HSQUIRRELVM v){
 	return 0;
 };
 
+SQInteger sqOnUpdate(HSQUIRRELVM v){
+	HSQOBJECT func;
+
+	sq_getstackobj(v, 2, &func);
+	xySetUpdateFunc(func);
+
+	return 0;
+};
+
+SQInteger sqOnDraw(HSQUIRRELVM v){
+	HSQOBJECT func;
+
+	sq_getstackobj(v, 2, &func);
+	xySetDrawFunc(func);
+
+	return 0;
+};
+
+SQInteger sqSetTickRate(HSQUIRRELVM v){
+	SQInteger rate, catchup = 5;
+
+	sq_getinteger(v, 2, &rate);
+	if(sq_gettop(v) > 2) sq_getinteger(v, 3, &catchup);
+
+	if(rate <= 0){
+		xyPrint(0, "Tick rate must be above zero.");
+		return 0;
+	};
+	xySetTickRate(rate, (catchup > 0 ? catchup : 1));
+
+	return 0;
+};
+
+SQInteger sqRunLoop(HSQUIRRELVM v){
+	xyRun();
+
+	return 0;
+};
+
+SQInteger sqStopLoop(HSQUIRRELVM v){
+	xyStopLoop();
+
+	return 0;
+};
+
+SQInteger sqLoadProgress(HSQUIRRELVM v){
+	SQInteger h;
+
+	if(sq_gettop(v) > 1){
+		sq_getinteger(v, 2, &h);
+		sq_pushfloat(v, xyLoadProgress(h));
+	} else sq_pushfloat(v, xyLoadProgress());
+
+	return 1;
+};
+
+SQInteger sqLoadResult(HSQUIRRELVM v){
+	SQInteger h;
+
+	sq_getinteger(v, 2, &h);
+
+	sq_pushinteger(v, xyLoadResult(h));
+
+	return 1;
+};
+
+SQInteger sqOnLoaded(HSQUIRRELVM v){
+	HSQOBJECT func;
+
+	sq_getstackobj(v, 2, &func);
+	xySetLoadedFunc(func);
+
+	return 0;
+};
+
+SQInteger sqSetLoadBudget(HSQUIRRELVM v){
+	SQInteger us;
+
+	sq_getinteger(v, 2, &us);
+
+	gvLoadBudget = (us > 0 ? us : 0);
+
+	return 0;
+};
+
+SQInteger sqIsHeadless(HSQUIRRELVM v){
+	sq_pushbool(v, gvHeadless);
+
+	return 1;
+};
+
 SQInteger sqGetOS(HSQUIRRELVM v){
 	switch(xyGetOS()){
 		case 0:
@@ -81,11 +181,64 @@ SQInteger sqSetFPS(HSQUIRRELVM v){
     if(iMax < 0){
     	xyPrint(0, "Maximum FPS cannot be negative.");
 		return 0;
-    } else gvMaxFPS = iMax;
+    } else xyPacerSetRate(iMax);
+
+	return 0;
+};
+
+SQInteger sqSetFrameMode(HSQUIRRELVM v){
+	SQInteger mode;
+
+	sq_getinteger(v, 2, &mode);
+	xyPacerSetMode(mode);
+
+	return 0;
+};
+
+SQInteger sqGetFrameTime(HSQUIRRELVM v){
+	sq_pushinteger(v, gvFrameTime);
+
+	return 1;
+};
+
+SQInteger sqStartCapture(HSQUIRRELVM v){
+	const SQChar* path;
+	SQInteger format;
+
+	sq_getstring(v, 2, &path);
+	sq_getinteger(v, 3, &format);
+
+	sq_pushbool(v, xyStartCapture(path, format));
+
+	return 1;
+};
+
+SQInteger sqStopCapture(HSQUIRRELVM v){
+	xyStopCapture();
 
 	return 0;
 };
 
+SQInteger sqGetCaptureStats(HSQUIRRELVM v){
+	const xyCaptureStats& stats = xyGetCaptureStats();
+
+	sq_newtable(v);
+
+	sq_pushstring(v, "captured", -1);
+	sq_pushinteger(v, stats.captured);
+	sq_newslot(v, -3, SQFalse);
+
+	sq_pushstring(v, "written", -1);
+	sq_pushinteger(v, stats.written);
+	sq_newslot(v, -3, SQFalse);
+
+	sq_pushstring(v, "dropped", -1);
+	sq_pushinteger(v, stats.dropped);
+	sq_newslot(v, -3, SQFalse);
+
+	return 1;
+};
+
 SQInteger sqSetWindowTitle(HSQUIRRELVM v){
 	const char* t;
 
@@ -106,14 +259,58 @@ SQInteger sqImport(HSQUIRRELVM v){
 
 	sq_getstring(v, 2, &a);
 
-	string b = gvAppDir;
-	b += "xylib/";
-	b += a;
-	b += ".nut";
+	//Pushes the module's value, or null
+	xyImport(v, a);
 
-	sqstd_dofile(gvSquirrel, b.c_str(), 0, 1);
+	return 1;
+};
 
-	return 0;
+SQInteger sqReloadModule(HSQUIRRELVM v){
+	const char* a;
+
+	sq_getstring(v, 2, &a);
+
+	sq_pushbool(v, xyReloadModule(v, a));
+
+	return 1;
+};
+
+SQInteger sqGetModules(HSQUIRRELVM v){
+	vector<const xyModule*> mods;
+	xyListModules(mods);
+
+	sq_newarray(v, 0);
+	for(int i = 0; i < mods.size(); i++){
+		sq_newtable(v);
+
+		sq_pushstring(v, "name", -1);
+		sq_pushstring(v, mods[i]->name.c_str(), -1);
+		sq_newslot(v, -3, SQFalse);
+
+		sq_pushstring(v, "loaded", -1);
+		sq_pushbool(v, mods[i]->state == _MS_LOADED);
+		sq_newslot(v, -3, SQFalse);
+
+		sq_pushstring(v, "time", -1);
+		sq_pushinteger(v, mods[i]->time);
+		sq_newslot(v, -3, SQFalse);
+
+		sq_pushstring(v, "self", -1);
+		sq_pushinteger(v, mods[i]->self);
+		sq_newslot(v, -3, SQFalse);
+
+		sq_pushstring(v, "deps", -1);
+		sq_newarray(v, 0);
+		for(int j = 0; j < mods[i]->deps.size(); j++){
+			sq_pushstring(v, mods[i]->deps[j].c_str(), -1);
+			sq_arrayappend(v, -2);
+		};
+		sq_newslot(v, -3, SQFalse);
+
+		sq_arrayappend(v, -2);
+	};
+
+	return 1;
 };
 
 SQInteger sqDoNut(HSQUIRRELVM v){
@@ -131,7 +328,7 @@ SQInteger sqDoNut(HSQUIRRELVM v){
 	*/
 
 	xyPrint(0, "Running %s...", a);
-	sqstd_dofile(gvSquirrel, a, 0, 1);
+	xyDoFile(a);
 
 	return 0;
 };
@@ -191,28 +388,30 @@ SQInteger sqFileAppend(HSQUIRRELVM v){
 
 SQInteger sqFileRead(HSQUIRRELVM v){
 	const char* f;
-	int l;
-	ifstream t;
+	string b;
 
 	sq_getstring(v, 2, &f);
 
-	if(!xyFileExists(f)){
+	if(!xyReadFile(f, b)){
 		xyPrint(0, "WARNING: %s does not exist!", f);
 		sq_pushstring(v, "-1", 2);
 		return 1;
 	} else {
-		t.open(f);
-		t.seekg(0, ios::end);
-		l = t.tellg();
-		char* b = new char[l];
-		t.seekg(0, ios::beg);
-		t.read(b, l);
-		t.close();
-		sq_pushstring(v, b, l);
+		sq_pushstring(v, b.c_str(), b.size());
 		return 1;
 	};
 };
 
+SQInteger sqMountPak(HSQUIRRELVM v){
+	const char* f;
+
+	sq_getstring(v, 2, &f);
+
+	sq_pushbool(v, xyPakMount(f));
+
+	return 1;
+};
+
 //}
 
 //////////////
@@ -220,7 +419,7 @@ SQInteger sqFileRead(HSQUIRRELVM v){
 /////////////{
 
 SQInteger sqClearScreen(HSQUIRRELVM v){
-	SDL_RenderClear(gvRender);
+	xyClearScreen();
 
 	return 0;
 };
@@ -241,6 +440,49 @@ SQInteger sqResetDrawTarget(HSQUIRRELVM v){
 	return 0;
 };
 
+SQInteger sqPushDrawTarget(HSQUIRRELVM v){
+	SQInteger tex;
+
+	sq_getinteger(v, 2, &tex);
+
+	if(tex < 0 || vcTextures[tex] == 0) return 0;
+
+	//Scripts may draw the canvas before changing it again,
+	//so what they drew so far goes out first
+	xyBatchFlush();
+	xyPushDrawTarget(vcTextures[tex]);
+
+	return 0;
+};
+
+SQInteger sqPopDrawTarget(HSQUIRRELVM v){
+	xyPopDrawTarget();
+
+	return 0;
+};
+
+SQInteger sqNewCanvas(HSQUIRRELVM v){
+	SQInteger w, h;
+
+	sq_getinteger(v, 2, &w);
+	sq_getinteger(v, 3, &h);
+
+	sq_pushinteger(v, xyNewCanvas(w, h));
+
+	return 1;
+};
+
+SQInteger sqFreeCanvas(HSQUIRRELVM v){
+	SQInteger img;
+
+	sq_getinteger(v, 2, &img);
+
+	if(img < 0) return 0;
+	xyFreeCanvas(img);
+
+	return 0;
+};
+
 SQInteger sqDrawImage(HSQUIRRELVM v){
 	SQInteger x, y, img;
 
@@ -263,6 +505,16 @@ SQInteger sqSetDrawColor(HSQUIRRELVM v){
 	return 0;
 };
 
+SQInteger sqSetBlendMode(HSQUIRRELVM v){
+	SQInteger mode;
+
+	sq_getinteger(v, 2, &mode);
+
+	xyBatchSetBlend(xyStateBlendMode(mode));
+
+	return 0;
+};
+
 SQInteger sqLoadImage(HSQUIRRELVM v){
 	const char* file;
 
@@ -273,6 +525,64 @@ SQInteger sqLoadImage(HSQUIRRELVM v){
 	return 1;
 };
 
+//Load a list of images on every core and wait until they
+//are all textures. Returns a table for each file in order.
+SQInteger sqPreloadImages(HSQUIRRELVM v){
+	vector<xyLoadJob*> jobs;
+	Uint64 start = xyPacerNow();
+
+	sq_pushnull(v);
+	while(SQ_SUCCEEDED(sq_next(v, 2))){
+		const SQChar* file;
+		if(SQ_SUCCEEDED(sq_getstring(v, -1, &file))) jobs.push_back(xyLoaderQueue(xyLoaderNewJob(_LK_IMAGE, file)));
+		sq_pop(v, 2);
+	};
+	sq_pop(v, 1);
+
+	//Upload a slice at a time while the rest decode
+	while(xyLoaderBusy()){
+		if(xyLoaderUpload(4000) == 0) SDL_Delay(1);
+	};
+
+	sq_newarray(v, 0);
+	for(int i = 0; i < jobs.size(); i++){
+		sq_newtable(v);
+
+		sq_pushstring(v, "file", -1);
+		sq_pushstring(v, jobs[i]->path.c_str(), -1);
+		sq_newslot(v, -3, SQFalse);
+
+		sq_pushstring(v, "image", -1);
+		sq_pushinteger(v, jobs[i]->result);
+		sq_newslot(v, -3, SQFalse);
+
+		sq_pushstring(v, "decode", -1);
+		sq_pushinteger(v, jobs[i]->decode);
+		sq_newslot(v, -3, SQFalse);
+
+		sq_pushstring(v, "upload", -1);
+		sq_pushinteger(v, jobs[i]->upload);
+		sq_newslot(v, -3, SQFalse);
+
+		sq_arrayappend(v, -2);
+		xyLoaderFree(jobs[i]);
+	};
+
+	xyPrint(0, "Preloaded %d images in %d ms.", (int)jobs.size(), (int)(xyPacerMicros(start, xyPacerNow()) / 1000));
+
+	return 1;
+};
+
+SQInteger sqLoadImageAsync(HSQUIRRELVM v){
+	const char* file;
+
+	sq_getstring(v, 2, &file);
+
+	sq_pushinteger(v, xyLoadAsync(xyLoaderNewJob(_LK_IMAGE, file)));
+
+	return 1;
+};
+
 SQInteger sqLoadImageKeyed(HSQUIRRELVM v){
 	const char* file;
 	SQInteger key;
@@ -334,18 +644,131 @@ SQInteger sqSetResolution(HSQUIRRELVM v){
 		return 0;
 	};
 
-	SDL_Rect screensize;
-	screensize.x = 0;
-	screensize.y = 0;
-	screensize.w = w;
-	screensize.h = h;
-	SDL_RenderSetViewport(gvRender, &screensize);
-	SDL_RenderSetLogicalSize(gvRender, w, h);
-	SDL_SetWindowSize(gvWindow, w, h);
+	xySetResolution(w, h);
+
+	return 0;
+};
+
+SQInteger sqSetScreenMode(HSQUIRRELVM v){
+	SQInteger m;
+
+	sq_getinteger(v, 2, &m);
+
+	xySetScreenMode(m);
+
+	return 0;
+};
+
+SQInteger sqSetCamera(HSQUIRRELVM v){
+	SQFloat x, y, z = 1, a = 0;
+
+	sq_getfloat(v, 2, &x);
+	sq_getfloat(v, 3, &y);
+	if(sq_gettop(v) > 3) sq_getfloat(v, 4, &z);
+	if(sq_gettop(v) > 4) sq_getfloat(v, 5, &a);
+
+	xySetCamera(x, y, z, a);
+
+	return 0;
+};
+
+SQInteger sqPushCamera(HSQUIRRELVM v){
+	xyPushCamera();
+
+	return 0;
+};
+
+SQInteger sqPopCamera(HSQUIRRELVM v){
+	xyPopCamera();
+
+	return 0;
+};
+
+SQInteger sqSetDrawLayer(HSQUIRRELVM v){
+	SQInteger l;
+
+	sq_getinteger(v, 2, &l);
+
+	xyBatchSetLayer(l);
+
+	return 0;
+};
+
+SQInteger sqSetDrawDepth(HSQUIRRELVM v){
+	SQFloat z;
+
+	sq_getfloat(v, 2, &z);
+
+	xyBatchSetDepth(floor(z));
+
+	return 0;
+};
+
+SQInteger sqSetTextureSort(HSQUIRRELVM v){
+	SQBool b;
+
+	sq_getbool(v, 2, &b);
+
+	xyBatchSetTextureSort(b);
 
 	return 0;
 };
 
+SQInteger sqGetBatchStats(HSQUIRRELVM v){
+	const xyBatchStats& stats = xyGetBatchStats();
+
+	sq_newtable(v);
+
+	sq_pushstring(v, "flushes", -1);
+	sq_pushinteger(v, stats.flushes);
+	sq_newslot(v, -3, SQFalse);
+
+	sq_pushstring(v, "quads", -1);
+	sq_pushinteger(v, stats.quads);
+	sq_newslot(v, -3, SQFalse);
+
+	sq_pushstring(v, "largest", -1);
+	sq_pushinteger(v, stats.largest);
+	sq_newslot(v, -3, SQFalse);
+
+	sq_pushstring(v, "triangles", -1);
+	sq_pushinteger(v, stats.triangles);
+	sq_newslot(v, -3, SQFalse);
+
+	sq_pushstring(v, "commands", -1);
+	sq_pushinteger(v, stats.commands);
+	sq_newslot(v, -3, SQFalse);
+
+	sq_pushstring(v, "drawn", -1);
+	sq_pushinteger(v, stats.drawn);
+	sq_newslot(v, -3, SQFalse);
+
+	sq_pushstring(v, "culled", -1);
+	sq_pushinteger(v, stats.culled);
+	sq_newslot(v, -3, SQFalse);
+
+	//Renderer state changes made and avoided
+	const xyStateStats& state = xyGetStateStats();
+
+	sq_pushstring(v, "stateCalls", -1);
+	sq_pushinteger(v, state.calls);
+	sq_newslot(v, -3, SQFalse);
+
+	sq_pushstring(v, "stateSkipped", -1);
+	sq_pushinteger(v, state.skipped);
+	sq_newslot(v, -3, SQFalse);
+
+	sq_pushstring(v, "merged", -1);
+	sq_newarray(v, 0);
+	for(int i = 0; i < stats.merged.size(); i++){
+		sq_pushinteger(v, stats.merged[i]);
+		sq_arrayappend(v, -2);
+	};
+	sq_newslot(v, -3, SQFalse);
+
+	return 1;
+};
+
 //}
 
 /////////////
@@ -357,8 +780,7 @@ SQInteger sqSpriteName(HSQUIRRELVM v){
 
 	sq_getinteger(v, 2, &s);
 
-	if(vcSprites.size() <= s || s < 0) sq_pushstring(v, "N/A", 3);
-	else if(vcSprites[s] == 0) sq_pushstring(v, "N/A", 3);
+	if(s < 0 || vcSprites[s] == 0) sq_pushstring(v, "N/A", 3);
 	else sq_pushstring(v, vcSprites[s]->name.c_str(), vcSprites[s]->name.length());
 
 	return 1;
@@ -368,14 +790,10 @@ SQInteger sqFindSprite(HSQUIRRELVM v){
 	const char* n;
 	sq_getstring(v, 2, &n);
 
-	for(int i = 0; i < vcSprites.size(); i++){
-		if(vcSprites[i]->name.c_str() == n) {
-			sq_pushinteger(v, i);
-			return 1;
-		};
-	};
+	Uint32 spr = xyFindSprite(n);
+	if(spr != 0) sq_pushinteger(v, spr);
+	else sq_pushinteger(v, -1);
 
-	sq_pushinteger(v, -1);
 	return 1;
 };
 
@@ -392,9 +810,33 @@ SQInteger sqNewSprite(HSQUIRRELVM v){
 	sq_getinteger(v, 8, &py);
 	sq_getinteger(v, 9, &f);
 
-	xySprite* newSprite = new xySprite(i, w, h, m, p, px, py, f);
+	sq_pushinteger(v, xyNewSprite(i, w, h, m, p, px, py, f));
+	return 1;
+};
+
+SQInteger sqNewSpriteAsync(HSQUIRRELVM v){
+	SQInteger w, h, m, p, px, py, f;
+	const char* i;
+
+	sq_getstring(v, 2, &i);
+	sq_getinteger(v, 3, &w);
+	sq_getinteger(v, 4, &h);
+	sq_getinteger(v, 5, &m);
+	sq_getinteger(v, 6, &p);
+	sq_getinteger(v, 7, &px);
+	sq_getinteger(v, 8, &py);
+	sq_getinteger(v, 9, &f);
+
+	xyLoadJob* job = xyLoaderNewJob(_LK_SPRITE, i);
+	job->w = w;
+	job->h = h;
+	job->mar = m;
+	job->pad = p;
+	job->pvx = px;
+	job->pvy = py;
+	job->frames = f;
 
-	sq_pushinteger(v, newSprite->getnum());
+	sq_pushinteger(v, xyLoadAsync(job));
 	return 1;
 };
 
@@ -406,8 +848,7 @@ SQInteger sqDrawSprite(HSQUIRRELVM v){
 	sq_getinteger(v, 4, &x);
 	sq_getinteger(v, 5, &y);
 
-	if(vcSprites.size() <= i) return 0;
-	if(vcSprites[i] == 0) return 0;
+	if(i < 0 || vcSprites[i] == 0) return 0;
 
 	vcSprites[i]->draw(f, x, y);
 
@@ -416,7 +857,7 @@ SQInteger sqDrawSprite(HSQUIRRELVM v){
 
 SQInteger sqDrawSpriteEx(HSQUIRRELVM v){
 	SQInteger i, f, x, y, a, l;
-	float sx, sy;
+	float sx, sy, al;
 
 	sq_getinteger(v, 2, &i);
 	sq_getinteger(v, 3, &f);
@@ -426,34 +867,111 @@ SQInteger sqDrawSpriteEx(HSQUIRRELVM v){
 	sq_getinteger(v, 7, &l);
 	sq_getfloat(v, 8, &sx);
 	sq_getfloat(v, 9, &sy);
+	sq_getfloat(v, 10, &al);
 
-	if(vcSprites.size() <= i) return 0;
-	if(vcSprites[i] == 0) return 0;
+	if(i < 0 || vcSprites[i] == 0) return 0;
 
-	vcSprites[i]->drawex(f, x, y, a, static_cast<SDL_RendererFlip>(l), sx, sy);
+	//Alpha goes from 0 to 1
+	if(al < 0) al = 0;
+	if(al > 1) al = 1;
+
+	vcSprites[i]->drawex(f, x, y, a, static_cast<SDL_RendererFlip>(l), sx, sy, al * 255);
 
 	return 0;
 };
 
-SQInteger sqDeleteSprite(HSQUIRRELVM v){
-	SQInteger i;
-
-	sq_getinteger(v, 2, &i);
+//Draw one instance from drawSpriteBatch(). Fields are
+//frame, x, y, then optionally angle, scale and flip.
+static void sqDrawInstance(xySprite* spr, const float* d, SQInteger stride){
+	if(stride <= 3){
+		spr->draw(d[0], d[1], d[2]);
+		return;
+	};
 
-	if(i >= vcSprites.size()) return 0;
-	if(vcSprites[i] != 0) delete vcSprites[i];
+	float a = d[3];
+	float sc = (stride > 4 ? d[4] : 1);
+	int l = (stride > 5 ? (int)d[5] : 0);
 
-	return 0;
+	spr->drawex(d[0], d[1], d[2], a, static_cast<SDL_RendererFlip>(l), sc, sc);
 };
 
-//}
+SQInteger sqDrawSpriteBatch(HSQUIRRELVM v){
+	SQInteger i, stride = 3;
 
-///////////
-// INPUT //
-//////////{
+	sq_getinteger(v, 2, &i);
+	if(sq_gettop(v) > 3) sq_getinteger(v, 4, &stride);
 
-SQInteger sqKeyPress(HSQUIRRELVM v){
-	SQInteger a;
+	if(i < 0 || vcSprites[i] == 0) return 0;
+	if(stride < 3) return sq_throwerror(v, "Stride must be at least 3");
+
+	xySprite* spr = vcSprites[i];
+
+	//A blob is read straight from memory as 32-bit floats
+	if(sq_gettype(v, 3) == OT_INSTANCE){
+		SQUserPointer data;
+		if(SQ_FAILED(sqstd_getblob(v, 3, &data))) return sq_throwerror(v, "Expected an array or a blob");
+
+		const float* d = (const float*)data;
+		SQInteger count = sqstd_getblobsize(v, 3) / (sizeof(float) * stride);
+		for(SQInteger j = 0; j < count; j++){
+			sqDrawInstance(spr, d + (j * stride), stride);
+		};
+
+		return 0;
+	};
+
+	//Flat arrays are walked in place without calling
+	//back into the VM for every element
+	vector<float> d(stride);
+	SQInteger k = 0;
+
+	sq_pushnull(v);
+	while(SQ_SUCCEEDED(sq_next(v, 3))){
+		SQFloat n = 0;
+		sq_getfloat(v, -1, &n);
+		sq_pop(v, 2);
+
+		d[k++] = n;
+		if(k == stride){
+			sqDrawInstance(spr, &d[0], stride);
+			k = 0;
+		};
+	};
+	sq_pop(v, 1);
+
+	return 0;
+};
+
+SQInteger sqSetAtlas(HSQUIRRELVM v){
+	SQInteger size;
+
+	sq_getinteger(v, 2, &size);
+
+	if(size < 0) size = 0;
+	gvAtlasMaxSheet = size;
+
+	return 0;
+};
+
+SQInteger sqDeleteSprite(HSQUIRRELVM v){
+	SQInteger i;
+
+	sq_getinteger(v, 2, &i);
+
+	if(i < 0) return 0;
+	xyDeleteSprite(i);
+
+	return 0;
+};
+
+//}
+
+///////////
+// INPUT //
+//////////{
+
+SQInteger sqKeyPress(HSQUIRRELVM v){
+	SQInteger a;
 
 	sq_getinteger(v, 2, &a);
 	sq_pushinteger(v, xyKeyPress(a));
@@ -817,14 +1335,398 @@ SQInteger sqDrawText(HSQUIRRELVM v){
 	sq_getinteger(v, 4, &y);
 	sq_getstring(v, 5, &s);
 
-	if(f >= vcFonts.size()) return 0;
-	if(vcFonts[f] == 0) return 0;
+	if(f < 0 || vcFonts[f] == 0) return 0;
 
 	vcFonts[f]->draw(x, y, s);
 
 	return 0;
 };
 
+SQInteger sqNewText(HSQUIRRELVM v){
+	SQInteger f;
+	const char* s;
+
+	sq_getinteger(v, 2, &f);
+	sq_getstring(v, 3, &s);
+
+	if(f < 0) f = 0;
+
+	xyText* newtext = new xyText(f, s);
+
+	sq_pushinteger(v, newtext->getnum());
+
+	return 1;
+};
+
+SQInteger sqSetText(HSQUIRRELVM v){
+	SQInteger t;
+	const char* s;
+
+	sq_getinteger(v, 2, &t);
+	sq_getstring(v, 3, &s);
+
+	if(vcTexts[t] == 0) return 0;
+
+	vcTexts[t]->setText(s);
+
+	return 0;
+};
+
+SQInteger sqDrawTextObj(HSQUIRRELVM v){
+	SQInteger t;
+	SQFloat x, y;
+
+	sq_getinteger(v, 2, &t);
+	sq_getfloat(v, 3, &x);
+	sq_getfloat(v, 4, &y);
+
+	if(vcTexts[t] == 0) return 0;
+
+	vcTexts[t]->draw(x, y);
+
+	return 0;
+};
+
+SQInteger sqBakeText(HSQUIRRELVM v){
+	SQInteger t;
+	SQBool b;
+
+	sq_getinteger(v, 2, &t);
+	sq_getbool(v, 3, &b);
+
+	if(vcTexts[t] == 0) return 0;
+
+	vcTexts[t]->setBaked(b);
+
+	return 0;
+};
+
+SQInteger sqDeleteText(HSQUIRRELVM v){
+	SQInteger t;
+
+	sq_getinteger(v, 2, &t);
+
+	if(vcTexts[t] != 0) delete vcTexts[t];
+
+	return 0;
+};
+
+//}
+
+//////////////
+// TILEMAPS //
+/////////////{
+
+//Get a map from its index, or 0 if it doesn't exist
+static xyTilemap* sqGetTilemapArg(HSQUIRRELVM v, SQInteger idx){
+	SQInteger m;
+
+	sq_getinteger(v, idx, &m);
+
+	return vcTilemaps[m];
+};
+
+//Layers can be given by index or by name
+static int sqGetLayerArg(HSQUIRRELVM v, xyTilemap* map, SQInteger idx){
+	if(sq_gettype(v, idx) == OT_STRING){
+		const char* name;
+		sq_getstring(v, idx, &name);
+		return map->findLayer(name);
+	};
+
+	SQInteger l;
+	sq_getinteger(v, idx, &l);
+	return l;
+};
+
+SQInteger sqLoadTilemap(HSQUIRRELVM v){
+	const char* file;
+
+	sq_getstring(v, 2, &file);
+
+	xyTilemap* newMap = new xyTilemap(file);
+
+	sq_pushinteger(v, newMap->getnum());
+	return 1;
+};
+
+SQInteger sqDeleteTilemap(HSQUIRRELVM v){
+	SQInteger m;
+
+	sq_getinteger(v, 2, &m);
+
+	if(vcTilemaps[m] != 0) delete vcTilemaps[m];
+
+	return 0;
+};
+
+SQInteger sqTilemapLayer(HSQUIRRELVM v){
+	const char* name;
+
+	xyTilemap* map = sqGetTilemapArg(v, 2);
+	sq_getstring(v, 3, &name);
+
+	if(map == 0) sq_pushinteger(v, -1);
+	else sq_pushinteger(v, map->findLayer(name));
+
+	return 1;
+};
+
+SQInteger sqDrawTilemapLayer(HSQUIRRELVM v){
+	SQInteger x, y;
+
+	xyTilemap* map = sqGetTilemapArg(v, 2);
+	if(map == 0) return 0;
+
+	int l = sqGetLayerArg(v, map, 3);
+	sq_getinteger(v, 4, &x);
+	sq_getinteger(v, 5, &y);
+
+	if(l < 0) return 0;
+	map->drawLayer(l, x, y);
+
+	return 0;
+};
+
+SQInteger sqGetTile(HSQUIRRELVM v){
+	SQInteger l, x, y;
+
+	xyTilemap* map = sqGetTilemapArg(v, 2);
+	sq_getinteger(v, 3, &l);
+	sq_getinteger(v, 4, &x);
+	sq_getinteger(v, 5, &y);
+
+	if(map == 0 || l < 0) sq_pushinteger(v, 0);
+	else sq_pushinteger(v, map->getTile(l, x, y));
+
+	return 1;
+};
+
+SQInteger sqSetTile(HSQUIRRELVM v){
+	SQInteger l, x, y, g;
+
+	xyTilemap* map = sqGetTilemapArg(v, 2);
+	sq_getinteger(v, 3, &l);
+	sq_getinteger(v, 4, &x);
+	sq_getinteger(v, 5, &y);
+	sq_getinteger(v, 6, &g);
+
+	if(map == 0 || l < 0) return 0;
+	map->setTile(l, x, y, (Uint32)g);
+
+	return 0;
+};
+
+SQInteger sqSetTilemapCache(HSQUIRRELVM v){
+	SQBool c;
+
+	xyTilemap* map = sqGetTilemapArg(v, 2);
+	if(map == 0) return 0;
+
+	int l = sqGetLayerArg(v, map, 3);
+	sq_getbool(v, 4, &c);
+
+	if(l < 0) return 0;
+	map->setCached(l, c);
+
+	return 0;
+};
+
+SQInteger sqSetChunkBudget(HSQUIRRELVM v){
+	SQInteger b;
+
+	sq_getinteger(v, 2, &b);
+
+	if(b < 0) b = 0;
+	gvChunkBudget = b;
+
+	return 0;
+};
+
+//}
+
+///////////////
+// PARTICLES //
+//////////////{
+
+static xyEmitter* sqGetEmitterArg(HSQUIRRELVM v, SQInteger idx){
+	SQInteger e;
+
+	sq_getinteger(v, idx, &e);
+
+	return vcEmitters[e];
+};
+
+SQInteger sqNewEmitter(HSQUIRRELVM v){
+	SQInteger i;
+
+	sq_getinteger(v, 2, &i);
+
+	if(i < 0) i = 0;
+
+	xyEmitter* newemitter = new xyEmitter(i);
+
+	sq_pushinteger(v, newemitter->getnum());
+
+	return 1;
+};
+
+SQInteger sqDeleteEmitter(HSQUIRRELVM v){
+	SQInteger e;
+
+	sq_getinteger(v, 2, &e);
+
+	if(vcEmitters[e] != 0) delete vcEmitters[e];
+
+	return 0;
+};
+
+SQInteger sqEmitterPos(HSQUIRRELVM v){
+	SQFloat x, y;
+
+	xyEmitter* e = sqGetEmitterArg(v, 2);
+	sq_getfloat(v, 3, &x);
+	sq_getfloat(v, 4, &y);
+
+	if(e == 0) return 0;
+	e->setPos(x, y);
+
+	return 0;
+};
+
+SQInteger sqEmitterRate(HSQUIRRELVM v){
+	SQFloat r;
+
+	xyEmitter* e = sqGetEmitterArg(v, 2);
+	sq_getfloat(v, 3, &r);
+
+	if(e == 0) return 0;
+	e->setRate(r);
+
+	return 0;
+};
+
+SQInteger sqEmitterLife(HSQUIRRELVM v){
+	SQFloat a, b;
+
+	xyEmitter* e = sqGetEmitterArg(v, 2);
+	sq_getfloat(v, 3, &a);
+	sq_getfloat(v, 4, &b);
+
+	if(e == 0) return 0;
+	e->setLife(a, b);
+
+	return 0;
+};
+
+SQInteger sqEmitterSpeed(HSQUIRRELVM v){
+	SQFloat a, b, d, s;
+
+	xyEmitter* e = sqGetEmitterArg(v, 2);
+	sq_getfloat(v, 3, &a);
+	sq_getfloat(v, 4, &b);
+	sq_getfloat(v, 5, &d);
+	sq_getfloat(v, 6, &s);
+
+	if(e == 0) return 0;
+	e->setSpeed(a, b, d, s);
+
+	return 0;
+};
+
+SQInteger sqEmitterForce(HSQUIRRELVM v){
+	SQFloat x, y, d;
+
+	xyEmitter* e = sqGetEmitterArg(v, 2);
+	sq_getfloat(v, 3, &x);
+	sq_getfloat(v, 4, &y);
+	sq_getfloat(v, 5, &d);
+
+	if(e == 0) return 0;
+	e->setForce(x, y, d);
+
+	return 0;
+};
+
+SQInteger sqEmitterFrames(HSQUIRRELVM v){
+	SQInteger a, b;
+
+	xyEmitter* e = sqGetEmitterArg(v, 2);
+	sq_getinteger(v, 3, &a);
+	sq_getinteger(v, 4, &b);
+
+	if(e == 0) return 0;
+	e->setFrames(a, b);
+
+	return 0;
+};
+
+SQInteger sqEmitterColor(HSQUIRRELVM v){
+	SQInteger a, b;
+
+	xyEmitter* e = sqGetEmitterArg(v, 2);
+	sq_getinteger(v, 3, &a);
+	sq_getinteger(v, 4, &b);
+
+	if(e == 0) return 0;
+	e->setColor(a, b);
+
+	return 0;
+};
+
+SQInteger sqEmitterLimit(HSQUIRRELVM v){
+	SQInteger l;
+
+	xyEmitter* e = sqGetEmitterArg(v, 2);
+	sq_getinteger(v, 3, &l);
+	if(l < 0) l = 0;
+
+	if(e == 0) return 0;
+	e->setLimit(l);
+
+	return 0;
+};
+
+SQInteger sqEmitterBurst(HSQUIRRELVM v){
+	SQInteger n;
+
+	xyEmitter* e = sqGetEmitterArg(v, 2);
+	sq_getinteger(v, 3, &n);
+	if(n < 0) n = 0;
+
+	if(e == 0) return 0;
+	e->burst(n);
+
+	return 0;
+};
+
+SQInteger sqEmitterClear(HSQUIRRELVM v){
+	xyEmitter* e = sqGetEmitterArg(v, 2);
+
+	if(e == 0) return 0;
+	e->clear();
+
+	return 0;
+};
+
+SQInteger sqEmitterCount(HSQUIRRELVM v){
+	xyEmitter* e = sqGetEmitterArg(v, 2);
+
+	if(e == 0) sq_pushinteger(v, 0);
+	else sq_pushinteger(v, e->getcount());
+
+	return 1;
+};
+
+SQInteger sqDrawEmitter(HSQUIRRELVM v){
+	xyEmitter* e = sqGetEmitterArg(v, 2);
+
+	if(e == 0) return 0;
+	e->draw();
+
+	return 0;
+};
+
 //}
 
 ///////////
@@ -851,6 +1753,26 @@ SQInteger sqLoadMusic(HSQUIRRELVM v){
 	return 1;
 };
 
+SQInteger sqLoadSoundAsync(HSQUIRRELVM v){
+	const char* s;
+
+	sq_getstring(v, 2, &s);
+
+	sq_pushinteger(v, xyLoadAsync(xyLoaderNewJob(_LK_SOUND, s)));
+
+	return 1;
+};
+
+SQInteger sqLoadMusicAsync(HSQUIRRELVM v){
+	const char* m;
+
+	sq_getstring(v, 2, &m);
+
+	sq_pushinteger(v, xyLoadAsync(xyLoaderNewJob(_LK_MUSIC, m)));
+
+	return 1;
+};
+
 SQInteger sqPlaySound(HSQUIRRELVM v){
 	SQInteger s, l;
 
@@ -895,83 +1817,123 @@ SQInteger sqDeleteMusic(HSQUIRRELVM v){
 
 //}
 
-/////////////
-// SDL_GFX //
-////////////{
+////////////////
+// PRIMITIVES //
+///////////////{
 
 SQInteger sqDrawCircle(HSQUIRRELVM v){
-    SQInteger x, y, r;
-    SQBool f;
+	SQFloat x, y, r;
+	SQBool f;
 
-    sq_getinteger(v, 2, &x);
-    sq_getinteger(v, 3, &y);
-    sq_getinteger(v, 4, &r);
-    sq_getbool(v, 5, &f);
+	sq_getfloat(v, 2, &x);
+	sq_getfloat(v, 3, &y);
+	sq_getfloat(v, 4, &r);
+	sq_getbool(v, 5, &f);
 
-	if(f){
-		filledCircleColor(gvRender, x, y, r, gvDrawColor);
-    } else {
-		circleColor(gvRender, x, y, r, gvDrawColor);
-    };
+	xyDrawCircle(x, y, r, f);
 
-    return 0;
+	return 0;
 };
 
 SQInteger sqDrawRect(HSQUIRRELVM v){
-    SQInteger x, y, w, h;
-    SQBool f;
+	SQFloat x, y, w, h;
+	SQBool f;
 
-    sq_getinteger(v, 2, &x);
-    sq_getinteger(v, 3, &y);
-    sq_getinteger(v, 4, &w);
-    sq_getinteger(v, 5, &h);
-    sq_getbool(v, 6, &f);
+	sq_getfloat(v, 2, &x);
+	sq_getfloat(v, 3, &y);
+	sq_getfloat(v, 4, &w);
+	sq_getfloat(v, 5, &h);
+	sq_getbool(v, 6, &f);
 
-    if(f){
-		boxColor(gvRender, x, y, x + w, y + h, gvDrawColor);
-    } else {
-		rectangleColor(gvRender, x, y, x + w, y + h, gvDrawColor);
-    };
+	xyDrawRect(x, y, w, h, f);
 
-    return 0;
+	return 0;
 };
 
 SQInteger sqDrawPoint(HSQUIRRELVM v){
-    SQInteger x, y;
+	SQFloat x, y;
 
-    sq_getinteger(v, 2, &x);
-    sq_getinteger(v, 3, &y);
+	sq_getfloat(v, 2, &x);
+	sq_getfloat(v, 3, &y);
 
-    pixelColor(gvRender, x, y, gvDrawColor);
+	xyDrawPoint(x, y);
 
-    return 0;
+	return 0;
 };
 
 SQInteger sqDrawLine(HSQUIRRELVM v){
-	SQInteger x1, y1, x2, y2;
+	SQFloat x1, y1, x2, y2;
 
-	sq_getinteger(v, 2, &x1);
-    sq_getinteger(v, 3, &y1);
-    sq_getinteger(v, 4, &x2);
-    sq_getinteger(v, 5, &y2);
+	sq_getfloat(v, 2, &x1);
+	sq_getfloat(v, 3, &y1);
+	sq_getfloat(v, 4, &x2);
+	sq_getfloat(v, 5, &y2);
 
-    thickLineColor(gvRender, x1, y1, x2, y2, 1, gvDrawColor);
+	xyDrawLine(x1, y1, x2, y2, 1);
 
-    return 0;
+	return 0;
 };
 
 SQInteger sqDrawLineWide(HSQUIRRELVM v){
-	SQInteger x1, y1, x2, y2, w;
+	SQFloat x1, y1, x2, y2, w;
 
-	sq_getinteger(v, 2, &x1);
-    sq_getinteger(v, 3, &y1);
-    sq_getinteger(v, 4, &x2);
-    sq_getinteger(v, 5, &y2);
-    sq_getinteger(v, 6, &w);
+	sq_getfloat(v, 2, &x1);
+	sq_getfloat(v, 3, &y1);
+	sq_getfloat(v, 4, &x2);
+	sq_getfloat(v, 5, &y2);
+	sq_getfloat(v, 6, &w);
 
-    thickLineColor(gvRender, x1, y1, x2, y2, w, gvDrawColor);
+	xyDrawLine(x1, y1, x2, y2, w);
 
-    return 0;
+	return 0;
+};
+
+//Read a flat array of x, y pairs
+static void sqGetPoints(HSQUIRRELVM v, SQInteger idx, vector<SDL_FPoint>& pts){
+	SDL_FPoint p;
+	SQInteger k = 0;
+
+	pts.clear();
+	sq_pushnull(v);
+	while(SQ_SUCCEEDED(sq_next(v, idx))){
+		SQFloat n = 0;
+		sq_getfloat(v, -1, &n);
+		sq_pop(v, 2);
+
+		if(k++ % 2 == 0) p.x = n;
+		else {
+			p.y = n;
+			pts.push_back(p);
+		};
+	};
+	sq_pop(v, 1);
+};
+
+SQInteger sqDrawPolyline(HSQUIRRELVM v){
+	static vector<SDL_FPoint> pts;
+	SQFloat w = 1;
+	SQBool c = SQFalse;
+
+	sqGetPoints(v, 2, pts);
+	if(sq_gettop(v) > 2) sq_getfloat(v, 3, &w);
+	if(sq_gettop(v) > 3) sq_getbool(v, 4, &c);
+
+	xyDrawPolyline(pts, w, c);
+
+	return 0;
+};
+
+SQInteger sqDrawPolygon(HSQUIRRELVM v){
+	static vector<SDL_FPoint> pts;
+	SQBool f;
+
+	sqGetPoints(v, 2, pts);
+	sq_getbool(v, 3, &f);
+
+	if(f) xyDrawPolygon(pts);
+	else xyDrawPolyline(pts, 1, true);
+
+	return 0;
 };
 
 //}
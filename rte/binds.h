@@ -11,18 +11,36 @@
 
 //Main
 SQInteger sqUpdate(HSQUIRRELVM v);
+SQInteger sqOnUpdate(HSQUIRRELVM v);
+SQInteger sqOnDraw(HSQUIRRELVM v);
+SQInteger sqSetTickRate(HSQUIRRELVM v);
+SQInteger sqRunLoop(HSQUIRRELVM v);
+SQInteger sqStopLoop(HSQUIRRELVM v);
 SQInteger sqGetOS(HSQUIRRELVM v);
+SQInteger sqLoadProgress(HSQUIRRELVM v);
+SQInteger sqLoadResult(HSQUIRRELVM v);
+SQInteger sqOnLoaded(HSQUIRRELVM v);
+SQInteger sqSetLoadBudget(HSQUIRRELVM v);
+SQInteger sqIsHeadless(HSQUIRRELVM v);
 SQInteger sqGetTicks(HSQUIRRELVM v);
 SQInteger sqGetFPS(HSQUIRRELVM v);
 SQInteger sqSetFPS(HSQUIRRELVM v);
+SQInteger sqSetFrameMode(HSQUIRRELVM v);
+SQInteger sqGetFrameTime(HSQUIRRELVM v);
+SQInteger sqStartCapture(HSQUIRRELVM v);
+SQInteger sqStopCapture(HSQUIRRELVM v);
+SQInteger sqGetCaptureStats(HSQUIRRELVM v);
 SQInteger sqSetWindowTitle(HSQUIRRELVM v);
 
 //File IO
 SQInteger sqImport(HSQUIRRELVM v);
+SQInteger sqReloadModule(HSQUIRRELVM v);
+SQInteger sqGetModules(HSQUIRRELVM v);
 SQInteger sqDoNut(HSQUIRRELVM v);
 SQInteger sqFileExists(HSQUIRRELVM v);
 SQInteger sqFileWrite(HSQUIRRELVM v);
 SQInteger sqFileRead(HSQUIRRELVM v);
+SQInteger sqMountPak(HSQUIRRELVM v);
 SQInteger sqFileAppend(HSQUIRRELVM v);
 SQInteger sqGetDir(HSQUIRRELVM v);
 SQInteger sqSetDir(HSQUIRRELVM v);
@@ -33,25 +51,43 @@ SQInteger sqClearScreen(HSQUIRRELVM v);
 SQInteger sqSetDrawTarget(HSQUIRRELVM v);
 SQInteger sqDrawImage(HSQUIRRELVM v);
 SQInteger sqSetDrawColor(HSQUIRRELVM v);
+SQInteger sqSetBlendMode(HSQUIRRELVM v);
 SQInteger sqSetBackgroundColor(HSQUIRRELVM v);
 SQInteger sqLoadImage(HSQUIRRELVM v);
+SQInteger sqLoadImageAsync(HSQUIRRELVM v);
 SQInteger sqLoadImageKeyed(HSQUIRRELVM v);
+SQInteger sqPreloadImages(HSQUIRRELVM v);
 SQInteger sqSetScalingFilter(HSQUIRRELVM v);
 SQInteger sqSetResolution(HSQUIRRELVM v);
+SQInteger sqSetScreenMode(HSQUIRRELVM v);
+SQInteger sqGetBatchStats(HSQUIRRELVM v);
+SQInteger sqSetCamera(HSQUIRRELVM v);
+SQInteger sqPushCamera(HSQUIRRELVM v);
+SQInteger sqPopCamera(HSQUIRRELVM v);
+SQInteger sqSetDrawLayer(HSQUIRRELVM v);
+SQInteger sqSetDrawDepth(HSQUIRRELVM v);
+SQInteger sqSetTextureSort(HSQUIRRELVM v);
 
 //Sprites
 SQInteger sqSpriteName(HSQUIRRELVM v);
 SQInteger sqNewSprite(HSQUIRRELVM v);
+SQInteger sqNewSpriteAsync(HSQUIRRELVM v);
 SQInteger sqDrawSprite(HSQUIRRELVM v);
 SQInteger sqDrawSpriteEx(HSQUIRRELVM v);
+SQInteger sqDrawSpriteBatch(HSQUIRRELVM v);
 SQInteger sqDeleteSprite(HSQUIRRELVM v);
 SQInteger sqFindSprite(HSQUIRRELVM v);
+SQInteger sqSetAtlas(HSQUIRRELVM v);
 
 //Input
 SQInteger sqKeyPress(HSQUIRRELVM v);
 SQInteger sqKeyRelease(HSQUIRRELVM v);
 SQInteger sqKeyDown(HSQUIRRELVM v);
 SQInteger sqResetDrawTarget(HSQUIRRELVM v);
+SQInteger sqPushDrawTarget(HSQUIRRELVM v);
+SQInteger sqPopDrawTarget(HSQUIRRELVM v);
+SQInteger sqNewCanvas(HSQUIRRELVM v);
+SQInteger sqFreeCanvas(HSQUIRRELVM v);
 SQInteger sqLoadImage(HSQUIRRELVM v);
 SQInteger sqDrawImage(HSQUIRRELVM v);
 SQInteger sqMouseDown(HSQUIRRELVM v);
@@ -91,20 +127,55 @@ SQInteger sqAbs(HSQUIRRELVM v);
 //Text
 SQInteger sqNewFont(HSQUIRRELVM v);
 SQInteger sqDrawText(HSQUIRRELVM v);
+SQInteger sqNewText(HSQUIRRELVM v);
+SQInteger sqSetText(HSQUIRRELVM v);
+SQInteger sqDrawTextObj(HSQUIRRELVM v);
+SQInteger sqBakeText(HSQUIRRELVM v);
+SQInteger sqDeleteText(HSQUIRRELVM v);
+
+//Tilemaps
+SQInteger sqLoadTilemap(HSQUIRRELVM v);
+SQInteger sqDeleteTilemap(HSQUIRRELVM v);
+SQInteger sqTilemapLayer(HSQUIRRELVM v);
+SQInteger sqDrawTilemapLayer(HSQUIRRELVM v);
+SQInteger sqGetTile(HSQUIRRELVM v);
+SQInteger sqSetTile(HSQUIRRELVM v);
+SQInteger sqSetTilemapCache(HSQUIRRELVM v);
+SQInteger sqSetChunkBudget(HSQUIRRELVM v);
+
+//Particles
+SQInteger sqNewEmitter(HSQUIRRELVM v);
+SQInteger sqDeleteEmitter(HSQUIRRELVM v);
+SQInteger sqEmitterPos(HSQUIRRELVM v);
+SQInteger sqEmitterRate(HSQUIRRELVM v);
+SQInteger sqEmitterLife(HSQUIRRELVM v);
+SQInteger sqEmitterSpeed(HSQUIRRELVM v);
+SQInteger sqEmitterForce(HSQUIRRELVM v);
+SQInteger sqEmitterFrames(HSQUIRRELVM v);
+SQInteger sqEmitterColor(HSQUIRRELVM v);
+SQInteger sqEmitterLimit(HSQUIRRELVM v);
+SQInteger sqEmitterBurst(HSQUIRRELVM v);
+SQInteger sqEmitterClear(HSQUIRRELVM v);
+SQInteger sqEmitterCount(HSQUIRRELVM v);
+SQInteger sqDrawEmitter(HSQUIRRELVM v);
 
 //Audio
 SQInteger sqLoadSound(HSQUIRRELVM v);
 SQInteger sqLoadMusic(HSQUIRRELVM v);
+SQInteger sqLoadSoundAsync(HSQUIRRELVM v);
+SQInteger sqLoadMusicAsync(HSQUIRRELVM v);
 SQInteger sqPlaySound(HSQUIRRELVM v);
 SQInteger sqPlayMusic(HSQUIRRELVM v);
 SQInteger sqDeleteSound(HSQUIRRELVM v);
 SQInteger sqDeleteMusic(HSQUIRRELVM v);
 
-//SDL_gfx
+//Primitives
 SQInteger sqDrawCircle(HSQUIRRELVM v);
 SQInteger sqDrawRect(HSQUIRRELVM v);
 SQInteger sqDrawLine(HSQUIRRELVM v);
 SQInteger sqDrawPoint(HSQUIRRELVM v);
 SQInteger sqDrawLineWide(HSQUIRRELVM v);
+SQInteger sqDrawPolyline(HSQUIRRELVM v);
+SQInteger sqDrawPolygon(HSQUIRRELVM v);
 
 #endif
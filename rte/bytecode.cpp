@@ -0,0 +1,207 @@
+/*===============*\
+| BYTECODE SOURCE |
+\*===============*/
+
+#include "main.h"
+#include "global.h"
+#include "fileio.h"
+#include "pak.h"
+#include "bytecode.h"
+
+bool gvScriptCache = true;
+
+//What sq_readclosure reads from
+struct xyByteReader{
+	const Uint8* data;
+	size_t size;
+	size_t pos;
+};
+
+static SQInteger xyByteRead(SQUserPointer user, SQUserPointer buffer, SQInteger size){
+	xyByteReader* r = (xyByteReader*)user;
+	size_t left = r->size - r->pos;
+	if(size < 0 || (size_t)size > left) size = left;
+
+	memcpy(buffer, r->data + r->pos, size);
+	r->pos += size;
+	return size;
+};
+
+static SQInteger xyByteWrite(SQUserPointer user, SQUserPointer buffer, SQInteger size){
+	((string*)user)->append((const char*)buffer, size);
+	return size;
+};
+
+static Uint32 xyByteSizes(){
+	return sizeof(SQInteger) | (sizeof(SQFloat) << 8) | (sizeof(SQChar) << 16);
+};
+
+//Push a closure saved by sq_writeclosure
+static bool xyReadClosure(HSQUIRRELVM v, const Uint8* data, size_t size){
+	xyByteReader r;
+	r.data = data;
+	r.size = size;
+	r.pos = 0;
+
+	return SQ_SUCCEEDED(sq_readclosure(v, xyByteRead, &r));
+};
+
+static bool xyWriteCache(HSQUIRRELVM v, const string& file, Uint64 mtime, const Uint8* source, Uint64 size){
+	string code;
+	if(SQ_FAILED(sq_writeclosure(v, xyByteWrite, &code))) return false;
+
+	xyBytecodeHeader head;
+	memcpy(head.magic, "BRXC", 4);
+	head.version = SDL_SwapLE32(_BC_VERSION);
+	head.vm = SDL_SwapLE32(SQUIRREL_VERSION_NUMBER);
+	head.sizes = SDL_SwapLE32(xyByteSizes());
+	head.mtime = SDL_SwapLE64(mtime);
+	head.size = SDL_SwapLE64(size);
+	head.hash = SDL_SwapLE64(xyHashBytes(source, size));
+
+	ofstream f(file.c_str(), ios::out | ios::binary);
+	if(!f.is_open()) return false;
+	f.write((const char*)&head, sizeof(head));
+	f.write(code.data(), code.size());
+	f.close();
+
+	//Don't leave half a cache behind
+	if(f.fail()){
+		remove(file.c_str());
+		return false;
+	};
+
+	return true;
+};
+
+//Load a script as a closure on top of the stack,
+//from its cache if it's still good
+static bool xyScriptLoad(HSQUIRRELVM v, const char* file, bool save){
+	string cachefile = string(file) + ".bxc";
+
+	//Loose scripts win over packed ones, like other files
+	struct stat info;
+	bool loose = (stat(file, &info) == 0);
+	const Uint8* data = 0;
+	Uint64 size = 0;
+	string text;
+
+	if(!loose && !xyPakFind(file, &data, &size)){
+		//Let Squirrel report it
+		return SQ_SUCCEEDED(sqstd_loadfile(v, file, SQTrue));
+	};
+
+	if(loose){
+		size = info.st_size;
+		data = 0;
+	};
+
+	//Try the cache
+	string cache;
+	if(xyReadFile(cachefile.c_str(), cache) && cache.size() > sizeof(xyBytecodeHeader)){
+		xyBytecodeHeader head;
+		memcpy(&head, cache.data(), sizeof(head));
+
+		bool good = (memcmp(head.magic, "BRXC", 4) == 0
+			&& SDL_SwapLE32(head.version) == _BC_VERSION
+			&& SDL_SwapLE32(head.vm) == SQUIRREL_VERSION_NUMBER
+			&& SDL_SwapLE32(head.sizes) == xyByteSizes()
+			&& SDL_SwapLE64(head.size) == size);
+
+		//Touched since, but maybe not changed
+		bool moved = (!loose || SDL_SwapLE64(head.mtime) != (Uint64)info.st_mtime);
+		if(good && moved){
+			if(loose){
+				if(!xyReadFile(file, text)) return false;
+				data = (const Uint8*)text.data();
+				size = text.size();
+			};
+			good = (SDL_SwapLE64(head.hash) == xyHashBytes(data, size));
+		};
+
+		if(good && xyReadClosure(v, (const Uint8*)cache.data() + sizeof(head), cache.size() - sizeof(head))){
+			//Save the new time so the script isn't hashed every run
+			if(loose && moved && save) xyWriteCache(v, cachefile, info.st_mtime, data, size);
+			return true;
+		};
+	};
+
+	//Compile it
+	if(data == 0){
+		if(!xyReadFile(file, text)) return SQ_SUCCEEDED(sqstd_loadfile(v, file, SQTrue));
+		data = (const Uint8*)text.data();
+		size = text.size();
+	};
+
+	const Uint8* code = data;
+	Uint64 length = size;
+
+	//Already compiled, or UTF-16, which only sqstd_loadfile reads
+	if(length >= 2 && ((code[0] == 0xFA && code[1] == 0xFA) || (code[0] == 0xFF && code[1] == 0xFE) || (code[0] == 0xFE && code[1] == 0xFF))){
+		if(loose) return SQ_SUCCEEDED(sqstd_loadfile(v, file, SQTrue));
+		if(code[0] == 0xFA) return xyReadClosure(v, code, length);
+		xyPrint(0, "Unable to load %s! Packed scripts must be UTF-8.", file);
+		return false;
+	};
+
+	//Skip a UTF-8 byte order mark
+	if(length >= 3 && code[0] == 0xEF && code[1] == 0xBB && code[2] == 0xBF){
+		code += 3;
+		length -= 3;
+	};
+
+	if(SQ_FAILED(sq_compilebuffer(v, (const SQChar*)code, length, file, SQTrue))) return false;
+
+	if(loose && save) xyWriteCache(v, cachefile, info.st_mtime, data, size);
+
+	return true;
+};
+
+bool xyLoadScript(HSQUIRRELVM v, const char* file){
+	return xyScriptLoad(v, file, gvScriptCache);
+};
+
+//Make sure a script's cache is up to date
+bool xyCompileScript(HSQUIRRELVM v, const char* file){
+	if(!xyScriptLoad(v, file, true)) return false;
+	sq_pop(v, 1);
+
+	struct stat info;
+	if(stat((string(file) + ".bxc").c_str(), &info) != 0){
+		xyPrint(0, "Unable to write a cache for %s!", file);
+		return false;
+	};
+
+	return true;
+};
+
+//Compile every script under dir, for shipping
+//caches with a game or putting them in a pack
+bool xyCompileDir(const string& dir){
+	vector<string> files;
+	xyListFiles(dir, files);
+
+	//Compiling doesn't need anything bound
+	HSQUIRRELVM v = sq_open(1024);
+	sq_setprintfunc(v, xyPrint, xyPrint);
+	sqstd_seterrorhandlers(v);
+
+	int done = 0, failed = 0;
+	for(int i = 0; i < files.size(); i++){
+		size_t dot = files[i].find_last_of(".");
+		string ext = (dot != string::npos ? files[i].substr(dot) : "");
+		if(ext != ".nut" && ext != ".sq" && ext != ".brx") continue;
+
+		string path = dir + "/" + files[i];
+		if(xyCompileScript(v, path.c_str())) done++;
+		else {
+			xyPrint(0, "Unable to compile %s!", path.c_str());
+			failed++;
+		};
+	};
+
+	sq_close(v);
+
+	xyPrint(0, "Compiled %d scripts in %s, %d failed.", done, dir.c_str(), failed);
+	return failed == 0;
+};
@@ -0,0 +1,47 @@
+/*===============*\
+| BYTECODE HEADER |
+\*===============*/
+
+#ifndef _BYTECODE_H_
+#define _BYTECODE_H_
+
+#include "main.h"
+
+//Compiled script cache
+//
+//Compiling a script is the slowest part of
+//running it, so the compiled closure is saved
+//next to the script as <script>.bxc and read back
+//the next time instead of compiling again.
+//
+//A cache is only used if it was written by the
+//same Squirrel version for the same number sizes
+//and matches the script it came from. For a loose
+//script, a matching modified time and size is
+//enough. Otherwise the script's contents are
+//hashed and compared, so caches still work after
+//being copied or packed along with their scripts.
+//
+//Caches are only written next to loose scripts.
+//Scripts in a pack should be compiled before the
+//pack is built, with --compile <directory>.
+
+const Uint32 _BC_VERSION = 1;
+
+struct xyBytecodeHeader{
+	char magic[4];		//"BRXC"
+	Uint32 version;
+	Uint32 vm;			//SQUIRREL_VERSION_NUMBER
+	Uint32 sizes;		//SQInteger, SQFloat and SQChar sizes
+	Uint64 mtime;		//Of the script when it was compiled
+	Uint64 size;		//Of the script
+	Uint64 hash;		//FNV-1a of the script
+};
+
+extern bool gvScriptCache;	//Write caches for loose scripts
+
+bool xyLoadScript(HSQUIRRELVM v, const char* file);
+bool xyCompileScript(HSQUIRRELVM v, const char* file);
+bool xyCompileDir(const string& dir);
+
+#endif
@@ -0,0 +1,120 @@
+/*============*\
+| CACHE SOURCE |
+\*============*/
+
+#include "main.h"
+#include "global.h"
+#include "fileio.h"
+#include "registry.h"
+#include "cache.h"
+#include <map>
+
+struct xyCacheSlot{
+	Uint32 handle;
+	Uint32 refs;
+	string key;
+};
+
+//Keys to handles, and what each registry slot is cached as
+static map<string, Uint32> cKeys[4];
+static vector<xyCacheSlot> cSlots[4];
+
+static bool xyCacheKind(int kind){
+	return kind >= _LK_IMAGE && kind <= _LK_MUSIC;
+};
+
+string xyCacheKey(const char* path){
+	return xyNormalPath(path);
+};
+
+//Keyed images are only shared with the same color
+string xyCacheKey(const char* path, Uint32 color){
+	char tail[16];
+	snprintf(tail, sizeof(tail), "#%08X", color);
+	return xyNormalPath(path) + tail;
+};
+
+//Sprites are only shared if they cut the sheet the same way
+string xyCacheKey(const char* path, Uint32 w, Uint32 h, Uint32 mar, Uint32 pad, int pvx, int pvy, Uint32 frames){
+	char tail[96];
+	snprintf(tail, sizeof(tail), "#%u,%u,%u,%u,%d,%d,%u", w, h, mar, pad, pvx, pvy, frames);
+	return xyNormalPath(path) + tail;
+};
+
+//What a handle is cached as, or 0 if it isn't
+static xyCacheSlot* xyCacheSlotFor(int kind, Uint32 handle){
+	if(!xyCacheKind(kind)) return 0;
+
+	Uint32 index = xyHandleIndex(handle);
+	if(index >= cSlots[kind].size()) return 0;
+
+	xyCacheSlot& slot = cSlots[kind][index];
+	if(slot.refs == 0 || slot.handle != handle) return 0;
+	return &slot;
+};
+
+//The handle of a cached asset with one more reference,
+//or 0 if it has to be loaded
+Uint32 xyCacheGet(int kind, const string& key){
+	if(!xyCacheKind(kind)) return 0;
+
+	map<string, Uint32>::iterator it = cKeys[kind].find(key);
+	if(it == cKeys[kind].end()) return 0;
+
+	cSlots[kind][xyHandleIndex(it->second)].refs++;
+	return it->second;
+};
+
+//Remember a freshly loaded asset with one reference
+void xyCachePut(int kind, const string& key, Uint32 handle){
+	if(!xyCacheKind(kind) || handle == 0) return;
+
+	Uint32 index = xyHandleIndex(handle);
+	if(cSlots[kind].size() <= index) cSlots[kind].resize(index + 1);
+
+	xyCacheSlot& slot = cSlots[kind][index];
+	if(slot.refs > 0) cKeys[kind].erase(slot.key);
+	slot.handle = handle;
+	slot.refs = 1;
+	slot.key = key;
+	cKeys[kind][key] = handle;
+};
+
+//Let go of one reference. True if the asset should be
+//freed now, which is also the case if it was never cached.
+bool xyCacheDrop(int kind, Uint32 handle){
+	xyCacheSlot* slot = xyCacheSlotFor(kind, handle);
+	if(slot == 0) return true;
+
+	if(slot->refs > 1){
+		slot->refs--;
+		return false;
+	};
+
+	xyCacheForget(kind, handle);
+	return true;
+};
+
+//Stop sharing an asset, like when it is about to change
+void xyCacheForget(int kind, Uint32 handle){
+	xyCacheSlot* slot = xyCacheSlotFor(kind, handle);
+	if(slot == 0) return;
+
+	cKeys[kind].erase(slot->key);
+	slot->refs = 0;
+	slot->key.clear();
+};
+
+Uint32 xyCacheRefs(int kind, Uint32 handle){
+	xyCacheSlot* slot = xyCacheSlotFor(kind, handle);
+	if(slot == 0) return 0;
+	return slot->refs;
+};
+
+//Everything is about to be freed anyway
+void xyCacheClear(){
+	for(int i = 0; i < 4; i++){
+		cKeys[i].clear();
+		cSlots[i].clear();
+	};
+};
@@ -0,0 +1,33 @@
+/*============*\
+| CACHE HEADER |
+\*============*/
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include "main.h"
+#include "loader.h"
+
+//Asset cache
+//
+//Images, sprites, sounds and music loaded from
+//a file are remembered by their path, so loading
+//the same file again gives back the same handle
+//instead of reading it a second time. Each load
+//counts as a reference, and deleting only frees
+//the asset once the last reference is gone.
+//
+//Kinds are the same as the loader's _LK_ ones.
+
+string xyCacheKey(const char* path);
+string xyCacheKey(const char* path, Uint32 color);
+string xyCacheKey(const char* path, Uint32 w, Uint32 h, Uint32 mar, Uint32 pad, int pvx, int pvy, Uint32 frames);
+
+Uint32 xyCacheGet(int kind, const string& key);
+void xyCachePut(int kind, const string& key, Uint32 handle);
+bool xyCacheDrop(int kind, Uint32 handle);
+void xyCacheForget(int kind, Uint32 handle);
+Uint32 xyCacheRefs(int kind, Uint32 handle);
+void xyCacheClear();
+
+#endif
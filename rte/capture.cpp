@@ -0,0 +1,226 @@
+/*==============*\
+| CAPTURE SOURCE |
+\*==============*/
+
+#include "main.h"
+#include "global.h"
+#include "graphics.h"
+#include "renderstate.h"
+#include "capture.h"
+
+struct xyCaptureSlot{
+	vector<Uint32> pixels;	//ARGB, one row after another
+	Uint32 frame;
+};
+
+//Buffers queued for the worker run from cTail
+//to cHead. The main thread only fills the slot
+//at cHead and the worker only reads the one at
+//cTail, so neither holds the lock while copying.
+static const int captureSlots = 8;
+static vector<xyCaptureSlot> cRing;
+static int cHead = 0, cTail = 0, cQueued = 0;
+static SDL_mutex* cLock = 0;
+static SDL_cond* cWake = 0;
+static SDL_Thread* cThread = 0;
+static bool cStopping = 0;
+
+static int cFormat = _CF_PNG;
+static string cPath;
+static FILE* cFile = 0;		//Video file for _CF_Y4M
+static int cW = 0, cH = 0;	//Size of every frame
+static bool cLogical = 0;	//Screen was sm_logical before capturing
+static vector<Uint8> cYUV;	//Worker's conversion buffer
+
+static xyCaptureStats cStats = {0, 0, 0};
+static xyCaptureStats cCopy = {0, 0, 0};
+
+//Full range BT.601, averaged over each 2x2 block for color
+static void xyCaptureYUV(const Uint32* px, Uint8* out){
+	int cw = (cW + 1) / 2, ch = (cH + 1) / 2;
+	Uint8* py = out;
+	Uint8* pu = out + (cW * cH);
+	Uint8* pv = pu + (cw * ch);
+
+	for(int i = 0; i < cW * cH; i++){
+		int r = (px[i] >> 16) & 0xFF, g = (px[i] >> 8) & 0xFF, b = px[i] & 0xFF;
+		py[i] = (77 * r + 150 * g + 29 * b) >> 8;
+	};
+
+	for(int y = 0; y < ch; y++){
+		for(int x = 0; x < cw; x++){
+			int r = 0, g = 0, b = 0, n = 0;
+			for(int j = y * 2; j < min(y * 2 + 2, cH); j++){
+				for(int i = x * 2; i < min(x * 2 + 2, cW); i++){
+					Uint32 p = px[(j * cW) + i];
+					r += (p >> 16) & 0xFF;
+					g += (p >> 8) & 0xFF;
+					b += p & 0xFF;
+					n++;
+				};
+			};
+			r /= n;
+			g /= n;
+			b /= n;
+
+			pu[(y * cw) + x] = ((-43 * r - 85 * g + 128 * b) >> 8) + 128;
+			pv[(y * cw) + x] = ((128 * r - 107 * g - 21 * b) >> 8) + 128;
+		};
+	};
+};
+
+static void xyCaptureWrite(xyCaptureSlot& slot){
+	if(cFormat == _CF_Y4M){
+		if(cFile == 0) return;
+		int cw = (cW + 1) / 2, ch = (cH + 1) / 2;
+		cYUV.resize((cW * cH) + (cw * ch * 2));
+		xyCaptureYUV(&slot.pixels[0], &cYUV[0]);
+
+		fputs("FRAME\n", cFile);
+		fwrite(&cYUV[0], 1, cYUV.size(), cFile);
+		return;
+	};
+
+	char name[32];
+	snprintf(name, sizeof(name), "%06u.png", slot.frame);
+	SDL_Surface* surf = SDL_CreateRGBSurfaceWithFormatFrom(&slot.pixels[0], cW, cH, 32, cW * 4, SDL_PIXELFORMAT_ARGB8888);
+	if(surf == 0) return;
+	IMG_SavePNG(surf, (cPath + name).c_str());
+	SDL_FreeSurface(surf);
+};
+
+static int xyCaptureWorker(void* data){
+	SDL_LockMutex(cLock);
+	while(1){
+		while(cQueued == 0 && !cStopping) SDL_CondWait(cWake, cLock);
+		if(cQueued == 0) break; //Stopping with nothing left
+
+		xyCaptureSlot& slot = cRing[cTail];
+		SDL_UnlockMutex(cLock);
+
+		xyCaptureWrite(slot);
+
+		SDL_LockMutex(cLock);
+		cTail = (cTail + 1) % captureSlots;
+		cQueued--;
+		cStats.written++;
+	};
+	SDL_UnlockMutex(cLock);
+
+	return 0;
+};
+
+//Start writing every frame shown from now on. For PNG,
+//path is put in front of each file's number. Capturing
+//needs the screen texture, so sm_logical becomes sm_fit
+//until the capture stops.
+bool xyStartCapture(const string& path, int format){
+	if(cThread != 0) xyStopCapture();
+	if(gvRender == 0) return false;
+
+	if(xyGetScreenMode() == _SM_LOGICAL){
+		cLogical = 1;
+		xySetScreenMode(_SM_FIT);
+	};
+	if(gvScreen == 0){
+		xyStopCapture();
+		return false;
+	};
+
+	cFormat = (format == _CF_Y4M ? _CF_Y4M : _CF_PNG);
+	cPath = path;
+	cW = gvScrW;
+	cH = gvScrH;
+
+	if(cFormat == _CF_Y4M){
+		cFile = fopen(path.c_str(), "wb");
+		if(cFile == 0){
+			xyPrint(0, "Unable to open %s for capture!", path.c_str());
+			xyStopCapture();
+			return false;
+		};
+		fprintf(cFile, "YUV4MPEG2 W%d H%d F%u:1 Ip A1:1 C420jpeg\n", cW, cH, (gvMaxFPS > 0 ? gvMaxFPS : 60));
+	};
+
+	//Everything is allocated up front
+	cRing.resize(captureSlots);
+	for(int i = 0; i < captureSlots; i++) cRing[i].pixels.resize(cW * cH);
+	cHead = cTail = cQueued = 0;
+	cStopping = 0;
+	cStats.captured = cStats.written = cStats.dropped = 0;
+
+	cLock = SDL_CreateMutex();
+	cWake = SDL_CreateCond();
+	cThread = SDL_CreateThread(xyCaptureWorker, "capture", 0);
+	if(cThread == 0){
+		xyPrint(0, "Unable to start capture thread! SDL Error: %s\n", SDL_GetError());
+		xyStopCapture();
+		return false;
+	};
+
+	return true;
+};
+
+//Finish writing what is queued and let go of everything
+void xyStopCapture(){
+	if(cThread != 0){
+		SDL_LockMutex(cLock);
+		cStopping = 1;
+		SDL_CondSignal(cWake);
+		SDL_UnlockMutex(cLock);
+		SDL_WaitThread(cThread, 0);
+		cThread = 0;
+	};
+
+	if(cWake != 0) SDL_DestroyCond(cWake);
+	if(cLock != 0) SDL_DestroyMutex(cLock);
+	cWake = 0;
+	cLock = 0;
+
+	if(cFile != 0) fclose(cFile);
+	cFile = 0;
+
+	cRing.clear();
+	vector<Uint8>().swap(cYUV);
+
+	//Go back to sm_logical, unless the script picked another mode since
+	if(cLogical && xyGetScreenMode() == _SM_FIT) xySetScreenMode(_SM_LOGICAL);
+	cLogical = 0;
+};
+
+bool xyCapturing(){
+	return cThread != 0;
+};
+
+//Called by xyPresentScreen() with the frame finished
+//in gvScreen, right before it is shown
+void xyCaptureFrame(){
+	if(cThread == 0 || gvScreen == 0) return;
+
+	//Drop the frame if the worker is behind or the
+	//resolution changed since capturing started
+	SDL_LockMutex(cLock);
+	bool skip = (cQueued == captureSlots || gvScrW != cW || gvScrH != cH);
+	if(skip) cStats.dropped++;
+	SDL_UnlockMutex(cLock);
+	if(skip) return;
+
+	xyCaptureSlot& slot = cRing[cHead];
+	xyStateTarget(gvScreen);
+	if(SDL_RenderReadPixels(gvRender, 0, SDL_PIXELFORMAT_ARGB8888, &slot.pixels[0], cW * 4) != 0) return;
+
+	SDL_LockMutex(cLock);
+	slot.frame = cStats.captured++;
+	cHead = (cHead + 1) % captureSlots;
+	cQueued++;
+	SDL_CondSignal(cWake);
+	SDL_UnlockMutex(cLock);
+};
+
+//Counters copied under the lock, since the worker updates them
+const xyCaptureStats& xyGetCaptureStats(){
+	if(cLock != 0) SDL_LockMutex(cLock);
+	cCopy = cStats;
+	if(cLock != 0) SDL_UnlockMutex(cLock);
+	return cCopy;
+};
@@ -0,0 +1,35 @@
+/*==============*\
+| CAPTURE HEADER |
+\*==============*/
+
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include "main.h"
+
+//Frame capture
+//
+//Finished frames are copied out of the screen
+//texture into a small ring of buffers that are
+//allocated when capturing starts. A worker
+//thread takes them from there and writes them
+//out, so encoding and disk access never hold up
+//the game. When every buffer is still waiting
+//to be written, the frame is dropped instead.
+
+const int _CF_PNG = 0;	//Numbered PNG files
+const int _CF_Y4M = 1;	//One raw YUV4MPEG2 video
+
+struct xyCaptureStats{
+	Uint32 captured;	//Frames read back and queued
+	Uint32 written;		//Frames the worker has finished
+	Uint32 dropped;		//Frames skipped because the ring was full
+};
+
+bool xyStartCapture(const string& path, int format);
+void xyStopCapture();
+bool xyCapturing();
+void xyCaptureFrame();
+const xyCaptureStats& xyGetCaptureStats();
+
+#endif
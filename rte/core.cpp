@@ -365,6 +365,17 @@ void xyLoadCore(){
 	const bm_sub = 2; \
 	const bm_mult = 3; \
 	 \
+	const sm_logical = 0; \
+	const sm_fit = 1; \
+	const sm_integer = 2; \
+	 \
+	const pm_vsync = 0; \
+	const pm_sleep = 1; \
+	const pm_uncapped = 2; \
+	 \
+	const cf_png = 0; \
+	const cf_y4m = 1; \
+	 \
 	const os_windows = 0; \
 	const os_linux = 1; \
 	const os_android = 2; \
@@ -7,13 +7,107 @@
 #include "main.h"
 #include "global.h"
 #include "fileio.h"
+#include "pak.h"
+#include "bytecode.h"
 
 bool xyFileExists(const char* file){
-	//Checks if a file exists
+	//Checks if a file exists, loose or packed
 	struct stat buff;
 	if (stat(file, &buff) != -1) return true;
 
-	return false;
+	return xyAssetInPak(file);
+};
+
+//Read a whole file into a string
+bool xyReadFile(const char* file, string& out){
+	ifstream t(file, ios::in | ios::binary);
+	if(!t.is_open()){
+		const Uint8* data;
+		Uint64 size;
+		if(!xyPakFind(file, &data, &size)) return false;
+		out.assign((const char*)data, size);
+		return true;
+	};
+
+	t.seekg(0, ios::end);
+	out.resize(t.tellg());
+	t.seekg(0, ios::beg);
+	if(out.size() > 0) t.read(&out[0], out.size());
+
+	return true;
+};
+
+//Write a path the same way no matter how it was given,
+//so "./gfx\\a.png" and "gfx/b/../a.png" are both gfx/a.png
+string xyNormalPath(const string& path){
+	vector<string> parts;
+	string part;
+
+	for(size_t i = 0; i <= path.size(); i++){
+		char c = (i < path.size() ? path[i] : '/');
+		if(c != '/' && c != '\\'){
+			part += c;
+			continue;
+		};
+
+		if(part == ".." && parts.size() > 0 && parts.back() != "..") parts.pop_back();
+		else if(part != "" && part != ".") parts.push_back(part);
+		part.clear();
+	};
+
+	string out;
+	for(int i = 0; i < parts.size(); i++){
+		if(i > 0) out += '/';
+		out += parts[i];
+	};
+
+	return out;
+};
+
+//FNV-1a, 64 bit
+Uint64 xyHashBytes(const void* data, size_t size){
+	const Uint8* p = (const Uint8*)data;
+	Uint64 hash = 14695981039346656037ULL;
+	for(size_t i = 0; i < size; i++){
+		hash ^= p[i];
+		hash *= 1099511628211ULL;
+	};
+
+	return hash;
+};
+
+//Every file under a folder and the ones inside it,
+//relative to it and with forward slashes
+void xyListFiles(const string& dir, vector<string>& files, const string& sub){
+	DIR* folder = opendir((sub == "" ? dir : dir + "/" + sub).c_str());
+	if(folder == 0) return;
+
+	struct dirent* entry;
+	while((entry = readdir(folder)) != 0){
+		string name = entry->d_name;
+		if(name == "." || name == "..") continue;
+
+		string rel = (sub == "" ? name : sub + "/" + name);
+		struct stat info;
+		if(stat((dir + "/" + rel).c_str(), &info) != 0) continue;
+
+		if(info.st_mode & S_IFDIR) xyListFiles(dir, files, rel);
+		else files.push_back(rel);
+	};
+
+	closedir(folder);
+};
+
+//Run a script in the root table. Scripts come from
+//their compiled cache when it's still good.
+bool xyDoFile(const char* file){
+	if(!xyLoadScript(gvSquirrel, file)) return false;
+
+	sq_pushroottable(gvSquirrel);
+	SQRESULT result = sq_call(gvSquirrel, 1, SQFalse, SQTrue);
+	sq_pop(gvSquirrel, 1);
+
+	return SQ_SUCCEEDED(result);
 };
 
 // Credit to Nova Storm for the JSON encoding and decoding functions
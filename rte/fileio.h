@@ -10,6 +10,11 @@
 #include "main.h"
 
 bool xyFileExists(const char* file);
+bool xyReadFile(const char* file, string& out);
+bool xyDoFile(const char* file);
+string xyNormalPath(const string& path);
+Uint64 xyHashBytes(const void* data, size_t size);
+void xyListFiles(const string& dir, vector<string>& files, const string& sub = "");
 void sqDecodeJSONTable(HSQUIRRELVM v, cJSON *Item);
 SQInteger sqDecodeJSON(HSQUIRRELVM v);
 SQInteger sqLsDir(HSQUIRRELVM v);
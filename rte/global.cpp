@@ -7,6 +7,9 @@
 #include "global.h"
 #include "text.h"
 #include "shapes.h"
+#include "tilemap.h"
+#include "particles.h"
+#include "registry.h"
 
 bool gvQuit = 0;
 int gvMouseX = 0, gvMouseY = 0;
@@ -20,20 +23,26 @@ SDL_Texture *gvScreen;
 int gvError;
 Uint32 gvTicks = 0;
 Uint32 gvTickLast = 0;
+Uint32 gvFrame = 0;
 float gvFPS = 0;
 Uint32 gvMaxFPS = 60;
+Uint32 gvFrameTime = 0;
 const char *gvVNo = "v.1.0.3";
 const float pi = 3.14159265;
 bool gvClearScreen = 1;
+bool gvHeadless = 0;
 SDL_Event Event;
-vector<SDL_Texture*> vcTextures;
+xyRegistry<SDL_Texture*> vcTextures;
 bool gvDebug = 1;
-vector<xySprite*> vcSprites;
-vector<xyFont*> vcFonts;
+xyRegistry<xySprite*> vcSprites;
+xyRegistry<xyFont*> vcFonts;
+xyRegistry<xyText*> vcTexts;
 Uint32 gvBackColor;
 Uint32 gvDrawColor;
-vector<Mix_Chunk*> vcSounds;
-vector<Mix_Music*> vcMusic;
+xyRegistry<Mix_Chunk*> vcSounds;
+xyRegistry<Mix_Music*> vcMusic;
+xyRegistry<xyTilemap*> vcTilemaps;
+xyRegistry<xyEmitter*> vcEmitters;
 string gvAppDir;
 string gvWorkDir;
 const Uint8 *sdlKeys;
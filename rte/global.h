@@ -8,7 +8,11 @@
 #include "sprite.h"
 #include "text.h"
 #include "shapes.h"
+#include "tilemap.h"
+#include "particles.h"
+#include "registry.h"
 
+extern bool gvHeadless;				//No window, sound or frame limit
 extern bool gvQuit;					//Let's the game know when to quit
 extern int gvMouseX, gvMouseY;		//Mouse coordinates
 extern Uint32 gvScrW, gvScrH;		//Screen resolution
@@ -21,20 +25,25 @@ extern SDL_Texture *gvScreen;		//Main screen texture
 extern int gvError;					//Error code
 extern float gvFPS;
 extern Uint32 gvMaxFPS;
+extern Uint32 gvFrameTime;			//Microseconds between the last two frames
 extern Uint32 gvTicks;
 extern Uint32 gvTickLast;
+extern Uint32 gvFrame;				//Frames shown since starting
 extern const char *gvVNo;			//XYRE version number
 extern const float pi;				//Pi
 extern bool gvClearScreen;			//Whether to clear the screen on update
 extern SDL_Event Event;				//Used for event handling
-extern vector<SDL_Texture*> vcTextures;		//Keeps track of user-created textures
+extern xyRegistry<SDL_Texture*> vcTextures;		//Keeps track of user-created textures
 extern bool gvDebug;				//Controls whether or not debug output is printed
-extern vector<xySprite*> vcSprites;	//Vector containing all sprite pointers
+extern xyRegistry<xySprite*> vcSprites;	//Registry containing all sprite pointers
 extern Uint32 gvBackColor;			//Background color
 extern Uint32 gvDrawColor;			//Renderer color
-extern vector<xyFont*> vcFonts;	//Container for fonts
-extern vector<Mix_Chunk*> vcSounds;	//Container for sounds
-extern vector<Mix_Music*> vcMusic;	//Container for music
+extern xyRegistry<xyFont*> vcFonts;	//Container for fonts
+extern xyRegistry<xyText*> vcTexts;	//Container for text objects
+extern xyRegistry<Mix_Chunk*> vcSounds;	//Container for sounds
+extern xyRegistry<Mix_Music*> vcMusic;	//Container for music
+extern xyRegistry<xyTilemap*> vcTilemaps;	//Container for tilemaps
+extern xyRegistry<xyEmitter*> vcEmitters;	//Container for particle emitters
 extern string gvAppDir;				//Directory Brux is running from
 extern string gvWorkDir;			//Working directory, default is the game directory
 extern const Uint8 *sdlKeys;
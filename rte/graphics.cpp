@@ -7,6 +7,16 @@
 #include "global.h"
 #include "graphics.h"
 #include "fileio.h"
+#include "batch.h"
+#include "renderstate.h"
+#include "capture.h"
+#include "pak.h"
+#include "cache.h"
+
+//Current draw target, gvScreen for the screen
+static SDL_Texture* drawTarget = 0;
+static int targetW = 0, targetH = 0;
+static vector<SDL_Texture*> vcTargets; //Saved by xyPushDrawTarget()
 
 //////////
 //SYSTEM//
@@ -14,7 +24,8 @@
 
 //Clear screen
 void xyClearScreen(){
-	SDL_RenderClear(gvRender);
+	xyBatchFlush();
+	xyStateClear(xyGetRed(gvBackColor), xyGetGreen(gvBackColor), xyGetBlue(gvBackColor), xyGetAlpha(gvBackColor));
 };
 
 
@@ -30,31 +41,14 @@ void xySetDrawColor(int r, int g, int b, int a){
 	if(a > 255) a = 255;
 	if(a < 0) a = 0;
 
-	Uint8 _r = r, _g = g, _b = b, _a = a;
-
-	SDL_SetRenderDrawColor(gvRender, _r, _g, _b, _a);
+	//Shapes read it when they are recorded,
+	//so the renderer doesn't need to know
+	gvDrawColor = ((Uint32)r << 24) | ((Uint32)g << 16) | ((Uint32)b << 8) | (Uint32)a;
 };
 
 //Set draw color from 24- or 32-bit integer
 void xySetDrawColor(SQInteger color){
-	//If the value of color is too big for a 24-bit integer, then treat it as 32-bit
-	Uint8 r;
-	r = ((color & 0xFF000000) >> 24);
-
-	//Do the same for each color value
-	Uint8 g;
-	g = ((color & 0x00FF0000) >> 16);
-
-	Uint8 b;
-	b = ((color & 0x0000FF00) >> 8);
-
-	Uint8 a;
-	a = color & 0x000000FF;
-
-	//Set the color
-	SDL_SetRenderDrawColor(gvRender, r, g, b, a);
 	gvDrawColor = color;
-	if(SDL_BYTEORDER == SDL_LIL_ENDIAN) gvDrawColor = SDL_Swap32(gvDrawColor);
 };
 
 
@@ -98,13 +92,309 @@ void xyWait(int ticks){
 
 //Set draw target to a texture
 void xySetDrawTarget(Uint32 tex){
-	if(vcTextures.size() >= tex || vcTextures[tex] != 0)
-	SDL_SetRenderTarget(gvRender, vcTextures[tex]);
+	//0 is the screen
+	if(tex == 0){
+		xyResetDrawTarget();
+		return;
+	};
+
+	if(vcTextures[tex] != 0)
+	xySetDrawTexture(vcTextures[tex]);
+};
+
+//Point the renderer at a target without touching the batch
+static void xySwitchTarget(SDL_Texture* tex){
+	xyStateTarget(tex);
+
+	//Remember the size for culling
+	drawTarget = tex;
+	if(tex != 0) SDL_QueryTexture(tex, 0, 0, &targetW, &targetH);
+};
+
+//Same as above for textures the engine keeps to itself
+void xySetDrawTexture(SDL_Texture* tex){
+	xyBatchFlush();
+	xySwitchTarget(tex);
 };
 
 //Set draw target back to screen
 void xyResetDrawTarget(){
-	SDL_SetRenderTarget(gvRender, 0);
+	xySetDrawTexture(gvScreen);
+};
+
+//Draw to a texture for a while, then go back to
+//whatever was being drawn to before with xyPopDrawTarget().
+//Draws already recorded for the outer target wait until
+//it's flushed, so they still sort with the rest of it.
+void xyPushDrawTarget(SDL_Texture* tex){
+	vcTargets.push_back(drawTarget);
+	xyBatchSave();
+	xySwitchTarget(tex);
+};
+
+void xyPopDrawTarget(){
+	if(vcTargets.size() == 0){
+		xyResetDrawTarget();
+		return;
+	};
+
+	SDL_Texture* tex = vcTargets.back();
+	vcTargets.pop_back();
+	xyBatchRestore();
+	xySwitchTarget(tex);
+};
+
+//Size of whatever is being drawn to
+void xyGetTargetSize(int* w, int* h){
+	if(drawTarget == gvScreen){
+		*w = gvScrW;
+		*h = gvScrH;
+	} else {
+		*w = targetW;
+		*h = targetH;
+	};
+};
+
+//}
+
+//////////
+//SCREEN//
+/////////{
+
+//By default, SDL scales every draw from the game's
+//resolution to the window. In the framebuffer modes,
+//the game draws into gvScreen at its own resolution
+//instead, and the finished frame is scaled to the
+//window once in xyPresentScreen().
+
+static int screenMode = _SM_LOGICAL;
+static SDL_Rect screenDest = {0, 0, 0, 0}; //Where gvScreen was last shown in the window
+
+//Make a framebuffer matching the resolution
+static void xyMakeScreen(){
+	SDL_Texture* old = gvScreen;
+	SDL_Texture* target = xyStateGetTarget();
+	xyBatchFlush();
+
+	gvScreen = SDL_CreateTexture(gvRender, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, gvScrW, gvScrH);
+	if(gvScreen == 0){
+		xyPrint(0, "Unable to create the screen texture! SDL Error: %s\n", SDL_GetError());
+		screenMode = _SM_LOGICAL;
+		SDL_RenderSetLogicalSize(gvRender, gvScrW, gvScrH);
+	} else {
+		//Integer scaling should keep pixels sharp
+		if(screenMode == _SM_INTEGER) SDL_SetTextureScaleMode(gvScreen, SDL_ScaleModeNearest);
+	};
+
+	//Keep drawing to the screen if that's where things were going
+	if(target == old) xySetDrawTexture(gvScreen);
+
+	if(old != 0){
+		xyBatchForget(old);
+		xyStateForget(old);
+		SDL_DestroyTexture(old);
+	};
+};
+
+void xySetScreenMode(int mode){
+	if(mode < _SM_LOGICAL || mode > _SM_INTEGER) mode = _SM_LOGICAL;
+	screenMode = mode;
+
+	if(mode == _SM_LOGICAL){
+		if(gvScreen != 0){
+			SDL_Texture* old = gvScreen;
+			bool onScreen = (xyStateGetTarget() == old);
+			xyBatchForget(old);
+			xyStateForget(old);
+			gvScreen = 0;
+			if(onScreen) xySetDrawTexture(0);
+			SDL_DestroyTexture(old);
+		};
+
+		SDL_RenderSetLogicalSize(gvRender, gvScrW, gvScrH);
+		return;
+	};
+
+	//The window is drawn to at its real size from now on
+	SDL_RenderSetLogicalSize(gvRender, 0, 0);
+	SDL_RenderSetViewport(gvRender, 0);
+	xyMakeScreen();
+};
+
+int xyGetScreenMode(){
+	return screenMode;
+};
+
+//Change the game's resolution and resize the window to match
+void xySetResolution(int w, int h){
+	xyBatchFlush();
+	gvScrW = w;
+	gvScrH = h;
+
+	if(gvScreen != 0) xyMakeScreen();
+	else {
+		SDL_Rect screensize;
+		screensize.x = 0;
+		screensize.y = 0;
+		screensize.w = w;
+		screensize.h = h;
+		SDL_RenderSetViewport(gvRender, &screensize);
+		SDL_RenderSetLogicalSize(gvRender, w, h);
+	};
+
+	SDL_SetWindowSize(gvWindow, w, h);
+};
+
+//Show the finished frame
+void xyPresentScreen(){
+	xyBatchFlush();
+
+	if(gvScreen == 0){
+		SDL_RenderPresent(gvRender);
+		return;
+	};
+
+	SDL_Texture* target = xyStateGetTarget();
+	xyCaptureFrame();
+	xyStateTarget(0);
+
+	int ww = 1, wh = 1;
+	SDL_GetRendererOutputSize(gvRender, &ww, &wh);
+
+	//Largest whole multiple that fits, or the largest
+	//size that keeps the aspect ratio
+	float scale = min((float)ww / gvScrW, (float)wh / gvScrH);
+	if(screenMode == _SM_INTEGER && scale >= 1) scale = floor(scale);
+
+	screenDest.w = gvScrW * scale;
+	screenDest.h = gvScrH * scale;
+	screenDest.x = (ww - screenDest.w) / 2;
+	screenDest.y = (wh - screenDest.h) / 2;
+
+	//Black bars around the frame
+	xyStateClear(0, 0, 0, 0xFF);
+
+	SDL_RenderCopy(gvRender, gvScreen, 0, &screenDest);
+	SDL_RenderPresent(gvRender);
+
+	xyStateTarget(target);
+};
+
+//Turn a window position into a position in the
+//game's resolution when the framebuffer is shown
+bool xyScreenMouse(int* x, int* y){
+	if(gvScreen == 0 || screenDest.w == 0 || screenDest.h == 0) return false;
+
+	*x = ((*x - screenDest.x) * (int)gvScrW) / screenDest.w;
+	*y = ((*y - screenDest.y) * (int)gvScrH) / screenDest.h;
+	return true;
+};
+
+//}
+
+//////////
+//CAMERA//
+/////////{
+
+//The camera only moves what is drawn to the screen.
+//Draw targets are drawn to with their own coordinates,
+//so the engine can render chunks and baked text into
+//them no matter where the camera is.
+//
+//x and y are the world position shown at the top left
+//corner when zoom is 1. Zooming and rotating are done
+//around the middle of the screen.
+
+struct xyCamera{
+	float x, y, zoom, angle;
+	float c, s;		//Cosine and sine of the angle
+	bool moved;		//Anything but the default camera
+};
+
+static xyCamera camera = {0, 0, 1, 0, 1, 0, 0};
+static vector<xyCamera> vcCameras;
+
+void xySetCamera(float x, float y, float zoom, float angle){
+	if(zoom <= 0) zoom = 1;
+
+	camera.x = x;
+	camera.y = y;
+	camera.zoom = zoom;
+	camera.angle = angle;
+
+	double rad = angle * (pi / 180.0);
+	camera.c = cos(rad);
+	camera.s = sin(rad);
+	camera.moved = (x != 0 || y != 0 || zoom != 1 || angle != 0);
+};
+
+//Keep the camera so it can be brought back, like
+//when drawing a HUD on top of a scrolling world
+void xyPushCamera(){
+	vcCameras.push_back(camera);
+};
+
+void xyPopCamera(){
+	if(vcCameras.size() == 0) return;
+
+	camera = vcCameras.back();
+	vcCameras.pop_back();
+};
+
+//Move points from world to screen coordinates, then
+//return false if all of them are outside the target
+bool xyCameraPlace(SDL_FPoint* p, int n){
+	int tw, th;
+	xyGetTargetSize(&tw, &th);
+
+	if(camera.moved && drawTarget == gvScreen){
+		float mx = tw / 2.0, my = th / 2.0;
+		for(int i = 0; i < n; i++){
+			float dx = p[i].x - camera.x - mx;
+			float dy = p[i].y - camera.y - my;
+			p[i].x = (((dx * camera.c) + (dy * camera.s)) * camera.zoom) + mx;
+			p[i].y = (((dy * camera.c) - (dx * camera.s)) * camera.zoom) + my;
+		};
+	};
+
+	float x0 = p[0].x, y0 = p[0].y, x1 = p[0].x, y1 = p[0].y;
+	for(int i = 1; i < n; i++){
+		if(p[i].x < x0) x0 = p[i].x;
+		if(p[i].x > x1) x1 = p[i].x;
+		if(p[i].y < y0) y0 = p[i].y;
+		if(p[i].y > y1) y1 = p[i].y;
+	};
+
+	return !(x1 <= 0 || y1 <= 0 || x0 >= tw || y0 >= th);
+};
+
+//Area of the world the camera can see, for
+//things that pick what to draw themselves
+void xyCameraView(float* x0, float* y0, float* x1, float* y1){
+	int tw, th;
+	xyGetTargetSize(&tw, &th);
+
+	*x0 = 0;
+	*y0 = 0;
+	*x1 = tw;
+	*y1 = th;
+	if(!camera.moved || drawTarget != gvScreen) return;
+
+	//Turn the screen's corners back into the world
+	float mx = tw / 2.0, my = th / 2.0;
+	float cx[4] = {0, (float)tw, (float)tw, 0};
+	float cy[4] = {0, 0, (float)th, (float)th};
+	for(int i = 0; i < 4; i++){
+		float dx = (cx[i] - mx) / camera.zoom;
+		float dy = (cy[i] - my) / camera.zoom;
+		float wx = (dx * camera.c) - (dy * camera.s) + mx + camera.x;
+		float wy = (dx * camera.s) + (dy * camera.c) + my + camera.y;
+
+		if(i == 0 || wx < *x0) *x0 = wx;
+		if(i == 0 || wx > *x1) *x1 = wx;
+		if(i == 0 || wy < *y0) *y0 = wy;
+		if(i == 0 || wy > *y1) *y1 = wy;
+	};
 };
 
 //}
@@ -118,7 +408,7 @@ SDL_Texture* xyLoadTexture(const char*  path){
 	SDL_Texture* newTexture = 0;
 
 	//Load the surface
-	SDL_Surface* loadedSurface = IMG_Load(path);
+	SDL_Surface* loadedSurface = IMG_Load_RW(xyOpenAsset(path), 1);
 	if(loadedSurface == 0){
 		xyPrint(0, "Unable to load image %s! SDL_image Error: %s\n", path, IMG_GetError());
 	} else {
@@ -135,11 +425,29 @@ SDL_Texture* xyLoadTexture(const char*  path){
 	return newTexture;
 };
 
+//Load an image into a 32-bit ARGB surface so its
+//pixels can be read or copied into other textures
+SDL_Surface* xyLoadSurface(const char* path){
+	SDL_Surface* loadedSurface = IMG_Load_RW(xyOpenAsset(path), 1);
+	if(loadedSurface == 0){
+		xyPrint(0, "Unable to load image %s! SDL_image Error: %s\n", path, IMG_GetError());
+		return 0;
+	};
+
+	SDL_Surface* newSurface = SDL_ConvertSurfaceFormat(loadedSurface, SDL_PIXELFORMAT_ARGB8888, 0);
+	if(newSurface == 0){
+		xyPrint(0, "Unable to convert image %s! SDL Error: %s\n", path, SDL_GetError());
+	};
+
+	SDL_FreeSurface(loadedSurface);
+	return newSurface;
+};
+
 SDL_Texture* xyLoadTextureKeyed(const char*  path, Uint32 key){
 	SDL_Texture* newTexture = 0;
 
 	//Load the surface
-	SDL_Surface* loadedSurface = IMG_Load(path);
+	SDL_Surface* loadedSurface = IMG_Load_RW(xyOpenAsset(path), 1);
 	if(loadedSurface == 0){
 		xyPrint(0, "Unable to load image %s! SDL_image Error: %s\n", path, IMG_GetError());
 	} else {
@@ -158,74 +466,168 @@ SDL_Texture* xyLoadTextureKeyed(const char*  path, Uint32 key){
 	return newTexture;
 };
 
-//Load a texture and assign it to a slot in the textures list
+//Assign a texture to a free slot in the textures list
+Uint32 xyAddTexture(SDL_Texture* tex){
+	//Return the texture handle
+	return vcTextures.add(tex);
+};
+
+//Load a texture and assign it to a slot in the textures list.
+//A file that is already loaded gives back the same slot.
 Uint32 xyLoadImage(const char* path){
+	string ckey = xyCacheKey(path);
+	Uint32 hit = xyCacheGet(_LK_IMAGE, ckey);
+	if(hit != 0) return hit;
+
 	SDL_Texture* nimg = xyLoadTexture(path);
 
 	if(!nimg){
 		xyPrint(0, "Unable to load file: %s", path);
 		gvQuit = 1;
+		return xyAddTexture(nimg);
 	};
 
-	//Make sure vcTextures[0] == 0
-	if(vcTextures.size() == 1) vcTextures.push_back(0);
-
-	for(Uint32 i = 1; i < vcTextures.size(); i++){
-		if(vcTextures[i] == 0){
-			vcTextures[i] = nimg;
-			//Return the texture index
-			return i;
-		};
-	};
-
-	//Return the texture index
-	vcTextures.push_back(nimg);
-	return vcTextures.size() - 1;
+	Uint32 tex = xyAddTexture(nimg);
+	xyCachePut(_LK_IMAGE, ckey, tex);
+	return tex;
 };
 
 Uint32 xyLoadImageKeyed(const char* path, Uint32 key){
+	string ckey = xyCacheKey(path, key);
+	Uint32 hit = xyCacheGet(_LK_IMAGE, ckey);
+	if(hit != 0) return hit;
+
 	SDL_Texture* nimg = xyLoadTextureKeyed(path, key);
 
 	if(!nimg){
 		xyPrint(0, "Unable to load file: %s", path);
 		gvQuit = 1;
+		return xyAddTexture(nimg);
 	};
 
-	//Make sure vcTextures[0] == 0
-	if(vcTextures.size() == 1) vcTextures.push_back(0);
-
-	for(Uint32 i = 1; i < vcTextures.size(); i++){
-		if(vcTextures[i] == 0){
-			vcTextures[i] = nimg;
-			return i;
-		};
-	};
-
-	vcTextures.push_back(nimg);
-	return vcTextures.size() - 1;
+	Uint32 tex = xyAddTexture(nimg);
+	xyCachePut(_LK_IMAGE, ckey, tex);
+	return tex;
 };
 
 //Draw image
 void xyDrawImage(Uint32 tex, float x, float y){
-	SDL_Rect rec;
+	SDL_FRect rec;
 	rec.x = x;
 	rec.y = y;
-	if(vcTextures.size() > tex){ //If the argument is in range
-		if(vcTextures[tex] != 0){ //If the index points to an image
-			SDL_QueryTexture(vcTextures[tex], 0, 0, &rec.w, &rec.h);
-			SDL_RenderCopy(gvRender, vcTextures[tex], 0, &rec);
-		};
+	SDL_Texture* img = vcTextures[tex];
+	if(img != 0){ //If the handle points to an image
+		int w, h;
+		SDL_QueryTexture(img, 0, 0, &w, &h);
+		rec.w = w;
+		rec.h = h;
+		xyBatchQuad(img, 0, &rec);
 	};
 };
 
 //Delete image
 void xyDeleteImage(Uint32 tex){
-	if(tex > vcSprites.size()) return;
+	//Canvases go back to the pool instead
+	if(xyIsCanvas(tex)){
+		xyFreeCanvas(tex);
+		return;
+	};
+
+	//Stale handles are ignored
+	SDL_Texture* img = vcTextures[tex];
+	if(img == 0) return;
+
+	//Still used by another load of the same file
+	if(!xyCacheDrop(_LK_IMAGE, tex)) return;
+
+	xyBatchForget(img);
+	xyStateForget(img);
+	SDL_DestroyTexture(img);
+	vcTextures.remove(tex);
+};
+
+//Canvases are target textures that scripts can draw
+//to and then draw like any other image. Freed ones
+//are kept in buckets by size, so making a canvas the
+//same size again doesn't allocate anything.
+
+struct xyCanvasBucket{
+	int w, h;
+	vector<SDL_Texture*> spare;
+};
+
+static vector<xyCanvasBucket> vcCanvasPool;
+static vector<bool> vcIsCanvas; //Which slots in vcTextures are canvases, by slot
+static const Uint32 canvasSpares = 8; //Most spare canvases kept per size
 
-	SDL_DestroyTexture(vcTextures[tex]);
+static xyCanvasBucket& xyCanvasBucketFor(int w, int h){
+	for(int i = 0; i < vcCanvasPool.size(); i++){
+		if(vcCanvasPool[i].w == w && vcCanvasPool[i].h == h) return vcCanvasPool[i];
+	};
+
+	xyCanvasBucket bucket;
+	bucket.w = w;
+	bucket.h = h;
+	vcCanvasPool.push_back(bucket);
+	return vcCanvasPool.back();
+};
+
+Uint32 xyNewCanvas(int w, int h){
+	if(w < 1 || h < 1) return 0;
+
+	SDL_Texture* tex = 0;
+	xyCanvasBucket& bucket = xyCanvasBucketFor(w, h);
+	if(bucket.spare.size() > 0){
+		tex = bucket.spare.back();
+		bucket.spare.pop_back();
+	} else {
+		tex = SDL_CreateTexture(gvRender, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+		if(tex == 0){
+			xyPrint(0, "Unable to create canvas! SDL Error: %s\n", SDL_GetError());
+			return 0;
+		};
+	};
+
+	//Start out transparent, even when reused
+	xyPushDrawTarget(tex);
+	xyStateClear(0, 0, 0, 0);
+	xyPopDrawTarget();
+
+	Uint32 img = xyAddTexture(tex);
+	Uint32 slot = xyHandleIndex(img);
+	if(vcIsCanvas.size() <= slot) vcIsCanvas.resize(slot + 1, false);
+	vcIsCanvas[slot] = true;
+
+	return img;
+};
+
+//Give a canvas back to the pool
+void xyFreeCanvas(Uint32 img){
+	if(!xyIsCanvas(img)) return;
+	SDL_Texture* tex = vcTextures[img];
+	vcTextures.remove(img);
+	vcIsCanvas[xyHandleIndex(img)] = false;
+
+	//Stop drawing to it
+	xyBatchForget(tex);
+	if(drawTarget == tex) xyResetDrawTarget();
+	for(int i = 0; i < vcTargets.size(); i++){
+		if(vcTargets[i] == tex) vcTargets[i] = gvScreen;
+	};
+
+	int w = 0, h = 0;
+	SDL_QueryTexture(tex, 0, 0, &w, &h);
+	xyCanvasBucket& bucket = xyCanvasBucketFor(w, h);
+	if(bucket.spare.size() < canvasSpares) bucket.spare.push_back(tex);
+	else {
+		xyStateForget(tex);
+		SDL_DestroyTexture(tex);
+	};
+};
 
-	if(tex == vcSprites.size() - 1) vcSprites[tex] = 0; //Set the texture address to zero instead of removing it so other textures are not shifted over
-	else vcSprites.pop_back(); //If it's the last one, then remove it to save memory
+bool xyIsCanvas(Uint32 img){
+	if(vcTextures[img] == 0) return false;
+	return xyHandleIndex(img) < vcIsCanvas.size() && vcIsCanvas[xyHandleIndex(img)];
 };
 
 //Get FPS
@@ -7,11 +7,32 @@
 
 #include "main.h"
 
+//Screen modes
+const int _SM_LOGICAL = 0;	//SDL scales each draw to the window
+const int _SM_FIT = 1;		//Draw to gvScreen, then scale it to fit the window
+const int _SM_INTEGER = 2;	//Same, but only by whole multiples
+
 SDL_Texture* xyLoadTexture(const char*  path);
+SDL_Surface* xyLoadSurface(const char* path);
+Uint32 xyAddTexture(SDL_Texture* tex);
 void xyClearScreen();
 void xyWait(int ticks);
 void xySetDrawTarget(Uint32 tex);
+void xySetDrawTexture(SDL_Texture* tex);
 void xyResetDrawTarget();
+void xyPushDrawTarget(SDL_Texture* tex);
+void xyPopDrawTarget();
+void xyGetTargetSize(int* w, int* h);
+void xySetScreenMode(int mode);
+int xyGetScreenMode();
+void xySetResolution(int w, int h);
+void xyPresentScreen();
+bool xyScreenMouse(int* x, int* y);
+void xySetCamera(float x, float y, float zoom, float angle);
+void xyPushCamera();
+void xyPopCamera();
+bool xyCameraPlace(SDL_FPoint* p, int n);
+void xyCameraView(float* x0, float* y0, float* x1, float* y1);
 void xyDrawImage(Uint32 tex, float x, float y);
 Uint32 xyLoadImage(const char* path, Uint32 key);
 void xySetDrawColor(int r, int g, int b, int a);
@@ -20,6 +41,9 @@ Uint32 xyLoadImage(const char* path);
 Uint32 xyLoadImageKeyed(const char* path, Uint32 key);
 void xySetBackgroundColor(Uint32 color);
 void xyDeleteImage(Uint32 img);
+Uint32 xyNewCanvas(int w, int h);
+void xyFreeCanvas(Uint32 img);
+bool xyIsCanvas(Uint32 img);
 Uint8 xyGetRed(Uint32 color);
 Uint8 xyGetGreen(Uint32 color);
 Uint8 xyGetBlue(Uint32 color);
@@ -0,0 +1,438 @@
+/*=============*\
+| LOADER SOURCE |
+\*=============*/
+
+#include "main.h"
+#include "global.h"
+#include "graphics.h"
+#include "sprite.h"
+#include "audio.h"
+#include "pacer.h"
+#include "pak.h"
+#include "cache.h"
+#include "loader.h"
+
+Uint64 gvLoadBudget = 2000;
+
+//Jobs waiting for a worker, and jobs a worker has
+//finished that still need a texture. Both are only
+//touched with lLock held. Each list is used from
+//lHead/lDoneHead on, so taking a job doesn't shift
+//the rest of the list.
+static vector<xyLoadJob*> lQueue;
+static vector<xyLoadJob*> lDone;
+static Uint32 lHead = 0, lDoneHead = 0;
+static Uint32 lPending = 0;		//Queued or decoding
+static SDL_mutex* lLock = 0;
+static SDL_cond* lWake = 0;
+static vector<SDL_Thread*> lThreads;
+static bool lStopping = 0;
+static const int maxLoaders = 8;
+
+//Jobs started from scripts, by handle. Only the main
+//thread uses these, so they need no lock.
+static xyRegistry<xyLoadJob*> vcLoads;
+static vector<xyLoadJob*> lFinished;	//Waiting for onLoaded()
+static vector<xyLoadJob*> lSpent;		//Done with, freed once reported
+static Uint32 lAsyncTotal = 0, lAsyncDone = 0;	//Since the loader was last idle
+static HSQOBJECT lLoaded;
+static bool lHasLoaded = 0;
+static bool lFiring = 0;
+
+//Read and convert a file on a worker thread. Errors
+//are kept for later, since the log isn't thread safe.
+static void xyLoaderDecode(xyLoadJob* job){
+	Uint64 start = xyPacerNow();
+
+	//Sounds are converted to the mixer's format as they load
+	if(job->kind == _LK_SOUND){
+		job->chunk = Mix_LoadWAV_RW(xyOpenAsset(job->path.c_str()), 1);
+		if(job->chunk == 0) job->error = string("Failed to load ") + job->path + "! SDL_Mixer Error: " + Mix_GetError();
+		job->decode = xyPacerMicros(start, xyPacerNow());
+		return;
+	};
+
+	if(job->kind == _LK_MUSIC){
+		job->music = Mix_LoadMUS_RW(xyOpenAsset(job->path.c_str()), 1);
+		if(job->music == 0) job->error = string("Failed to load ") + job->path + "! SDL_Mixer Error: " + Mix_GetError();
+		job->decode = xyPacerMicros(start, xyPacerNow());
+		return;
+	};
+
+	SDL_Surface* loaded = IMG_Load_RW(xyOpenAsset(job->path.c_str()), 1);
+	if(loaded == 0){
+		job->error = string("Unable to load image ") + job->path + "! SDL_image Error: " + IMG_GetError();
+	} else {
+		//The key becomes alpha when converting
+		if(job->keyed) SDL_SetColorKey(loaded, true, SDL_MapRGB(loaded->format, xyGetRed(job->key), xyGetGreen(job->key), xyGetBlue(job->key)));
+
+		job->surf = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+		if(job->surf == 0) job->error = string("Unable to convert image ") + job->path + "! SDL Error: " + SDL_GetError();
+		SDL_FreeSurface(loaded);
+	};
+
+	job->decode = xyPacerMicros(start, xyPacerNow());
+};
+
+static bool xyLoaderDecoded(xyLoadJob* job){
+	return job->surf != 0 || job->chunk != 0 || job->music != 0;
+};
+
+static int xyLoaderWorker(void* data){
+	SDL_LockMutex(lLock);
+	while(1){
+		while(lHead == lQueue.size() && !lStopping) SDL_CondWait(lWake, lLock);
+		if(lStopping) break;
+
+		xyLoadJob* job = lQueue[lHead++];
+		if(lHead == lQueue.size()){
+			lQueue.clear();
+			lHead = 0;
+		};
+		SDL_UnlockMutex(lLock);
+
+		xyLoaderDecode(job);
+
+		SDL_LockMutex(lLock);
+		job->state = (xyLoaderDecoded(job) ? _LJ_DECODED : _LJ_FAILED);
+		lDone.push_back(job);
+		lPending--;
+	};
+	SDL_UnlockMutex(lLock);
+
+	return 0;
+};
+
+//Workers are only started once something is loaded
+static void xyLoaderStart(){
+	if(lLock != 0) return;
+
+	lLock = SDL_CreateMutex();
+	lWake = SDL_CreateCond();
+	lStopping = 0;
+
+	//Leave a core for the main thread
+	int n = SDL_GetCPUCount() - 1;
+	if(n < 1) n = 1;
+	if(n > maxLoaders) n = maxLoaders;
+
+	for(int i = 0; i < n; i++){
+		SDL_Thread* t = SDL_CreateThread(xyLoaderWorker, "loader", 0);
+		if(t != 0) lThreads.push_back(t);
+	};
+
+	if(lThreads.size() == 0) xyPrint(0, "Unable to start loader threads! SDL Error: %s\n", SDL_GetError());
+};
+
+//A job with nothing set but what to load
+xyLoadJob* xyLoaderNewJob(int kind, const string& path){
+	xyLoadJob* job = new xyLoadJob;
+	job->kind = kind;
+	job->path = path;
+	job->keyed = 0;
+	job->key = 0;
+	job->w = job->h = job->mar = job->pad = job->frames = 0;
+	job->pvx = job->pvy = 0;
+	job->async = 0;
+	job->handle = 0;
+	job->state = _LJ_QUEUED;
+	job->surf = 0;
+	job->chunk = 0;
+	job->music = 0;
+	job->result = 0;
+	job->decode = 0;
+	job->upload = 0;
+	job->spent = 0;
+	job->reported = 0;
+	return job;
+};
+
+//What the job is cached as once it is loaded
+static string xyLoaderKey(xyLoadJob* job){
+	if(job->kind == _LK_SPRITE) return xyCacheKey(job->path.c_str(), job->w, job->h, job->mar, job->pad, job->pvx, job->pvy, job->frames);
+	if(job->kind == _LK_IMAGE && job->keyed) return xyCacheKey(job->path.c_str(), job->key);
+	return xyCacheKey(job->path.c_str());
+};
+
+//Hand a job to the workers. Unless it is async, the
+//job belongs to the caller, who frees it once it is done.
+xyLoadJob* xyLoaderQueue(xyLoadJob* job){
+	xyLoaderStart();
+
+	//Already loaded, so it only has to be handed back
+	Uint32 hit = xyCacheGet(job->kind, xyLoaderKey(job));
+	if(hit != 0){
+		job->result = hit;
+		job->state = _LJ_DONE;
+		SDL_LockMutex(lLock);
+		lDone.push_back(job);
+		SDL_UnlockMutex(lLock);
+		return job;
+	};
+
+	//No threads to do it, so decode right here
+	if(lThreads.size() == 0){
+		xyLoaderDecode(job);
+		job->state = (xyLoaderDecoded(job) ? _LJ_DECODED : _LJ_FAILED);
+		SDL_LockMutex(lLock);
+		lDone.push_back(job);
+		SDL_UnlockMutex(lLock);
+		return job;
+	};
+
+	SDL_LockMutex(lLock);
+	lQueue.push_back(job);
+	lPending++;
+	SDL_CondSignal(lWake);
+	SDL_UnlockMutex(lLock);
+
+	return job;
+};
+
+//Add a decoded job to its list on the main thread
+static void xyLoaderFinish(xyLoadJob* job){
+	//The same file may have been loaded while this one decoded
+	string key = xyLoaderKey(job);
+	Uint32 hit = xyCacheGet(job->kind, key);
+	if(hit != 0){
+		if(job->surf != 0) SDL_FreeSurface(job->surf);
+		if(job->chunk != 0) Mix_FreeChunk(job->chunk);
+		if(job->music != 0) Mix_FreeMusic(job->music);
+		job->surf = 0;
+		job->chunk = 0;
+		job->music = 0;
+		job->result = hit;
+		job->state = _LJ_DONE;
+		return;
+	};
+
+	switch(job->kind){
+		case _LK_SPRITE: {
+			//The sprite frees the sheet
+			xySprite* spr = new xySprite(job->path.c_str(), job->w, job->h, job->mar, job->pad, job->pvx, job->pvy, job->frames, job->surf);
+			job->surf = 0;
+			job->result = spr->getnum();
+			break;
+		};
+		case _LK_SOUND:
+			job->result = xyAddSound(job->chunk);
+			job->chunk = 0;
+			break;
+		case _LK_MUSIC:
+			job->result = xyAddMusic(job->music);
+			job->music = 0;
+			break;
+		default: {
+			SDL_Texture* tex = SDL_CreateTextureFromSurface(gvRender, job->surf);
+			SDL_FreeSurface(job->surf);
+			job->surf = 0;
+
+			if(tex == 0){
+				xyPrint(0, "Unable to create texture from %s! SDL Error: %s\n", job->path.c_str(), SDL_GetError());
+				job->state = _LJ_FAILED;
+				return;
+			};
+			job->result = xyAddTexture(tex);
+			break;
+		};
+	};
+
+	xyCachePut(job->kind, key, job->result);
+	job->state = _LJ_DONE;
+};
+
+//Turn decoded surfaces into textures until the budget
+//in microseconds runs out. At least one is always done
+//so loading can't stall. Returns how many were done.
+Uint32 xyLoaderUpload(Uint64 budget){
+	if(lLock == 0) return 0;
+	Uint64 start = xyPacerNow();
+	Uint32 done = 0;
+
+	while(1){
+		SDL_LockMutex(lLock);
+		xyLoadJob* job = 0;
+		if(lDoneHead < lDone.size()) job = lDone[lDoneHead++];
+		if(lDoneHead == lDone.size()){
+			lDone.clear();
+			lDoneHead = 0;
+		};
+		SDL_UnlockMutex(lLock);
+		if(job == 0) break;
+		done++;
+
+		if(job->state == _LJ_FAILED) xyPrint(0, "%s\n", job->error.c_str());
+		if(job->state == _LJ_DECODED){
+			Uint64 began = xyPacerNow();
+			xyLoaderFinish(job);
+			job->upload = xyPacerMicros(began, xyPacerNow());
+		};
+
+		if(job->async){
+			lAsyncDone++;
+			lFinished.push_back(job);
+		};
+
+		if(xyPacerMicros(start, xyPacerNow()) >= budget) break;
+	};
+
+	return done;
+};
+
+//Anything still decoding or waiting for upload
+bool xyLoaderBusy(){
+	if(lLock == 0) return false;
+
+	SDL_LockMutex(lLock);
+	bool busy = (lPending > 0 || lDoneHead < lDone.size());
+	SDL_UnlockMutex(lLock);
+	return busy;
+};
+
+//Only finished or failed jobs can be freed
+void xyLoaderFree(xyLoadJob* job){
+	if(job == 0) return;
+	if(job->surf != 0) SDL_FreeSurface(job->surf);
+	if(job->chunk != 0) Mix_FreeChunk(job->chunk);
+	if(job->music != 0) Mix_FreeMusic(job->music);
+	delete job;
+};
+
+//Stop the workers. Jobs still queued are dropped.
+void xyLoaderQuit(){
+	if(lLock == 0) return;
+
+	SDL_LockMutex(lLock);
+	lStopping = 1;
+	SDL_CondBroadcast(lWake);
+	SDL_UnlockMutex(lLock);
+
+	for(int i = 0; i < lThreads.size(); i++) SDL_WaitThread(lThreads[i], 0);
+	lThreads.clear();
+
+	SDL_DestroyCond(lWake);
+	SDL_DestroyMutex(lLock);
+	lWake = 0;
+	lLock = 0;
+
+	for(Uint32 i = 1; i < vcLoads.slots(); i++) xyLoaderFree(vcLoads[vcLoads.handleAt(i)]);
+	vcLoads.clear();
+	lFinished.clear();
+	lSpent.clear();
+	if(lHasLoaded) sq_release(gvSquirrel, &lLoaded);
+	lHasLoaded = 0;
+};
+
+//Start a job for a script and return its handle.
+//The job is let go once its result has been read or
+//passed to onLoaded(), and its handle goes stale.
+Uint32 xyLoadAsync(xyLoadJob* job){
+	job->async = 1;
+	job->handle = vcLoads.add(job);
+	if(job->handle == 0){
+		xyLoaderFree(job);
+		return 0;
+	};
+	lAsyncTotal++;
+
+	xyLoaderQueue(job);
+	return job->handle;
+};
+
+//0 while waiting, 0.5 once decoded and 1 when ready
+float xyLoadProgress(Uint32 handle){
+	xyLoadJob* job = vcLoads[handle];
+	if(job == 0) return 0;
+
+	if(lLock != 0) SDL_LockMutex(lLock);
+	int state = job->state;
+	if(lLock != 0) SDL_UnlockMutex(lLock);
+
+	if(state == _LJ_QUEUED) return 0;
+	if(state == _LJ_DECODED) return 0.5;
+	return 1;
+};
+
+//Share of everything started since the loader was last idle
+float xyLoadProgress(){
+	if(lAsyncTotal == 0) return 1;
+	return (float)lAsyncDone / lAsyncTotal;
+};
+
+//Free a script's job once it's been dealt with
+static void xyLoaderSpend(xyLoadJob* job){
+	if(job->spent) return;
+	job->spent = 1;
+	lSpent.push_back(job);
+};
+
+//Jobs still waiting for onLoaded() are kept until
+//it has been called, since the call needs them
+static void xyLoaderSweep(){
+	Uint32 kept = 0;
+	for(int i = 0; i < lSpent.size(); i++){
+		xyLoadJob* job = lSpent[i];
+		if(!job->reported){
+			lSpent[kept++] = job;
+			continue;
+		};
+
+		vcLoads.remove(job->handle);
+		xyLoaderFree(job);
+	};
+	lSpent.resize(kept);
+};
+
+//What was loaded, or 0 if it isn't ready or failed.
+//Reading it lets the job go at the next update.
+Uint32 xyLoadResult(Uint32 handle){
+	xyLoadJob* job = vcLoads[handle];
+	if(job == 0) return 0;
+	if(xyLoadProgress(handle) < 1) return 0;
+
+	xyLoaderSpend(job);
+	return job->result;
+};
+
+void xySetLoadedFunc(HSQOBJECT func){
+	if(lHasLoaded) sq_release(gvSquirrel, &lLoaded);
+	lHasLoaded = (sq_isclosure(func) || sq_isnativeclosure(func));
+	lLoaded = func;
+	if(lHasLoaded) sq_addref(gvSquirrel, &lLoaded);
+};
+
+//Called once per frame from xyUpdate(). Finishes async
+//loads within the budget, then tells the script about them.
+void xyLoaderUpdate(){
+	if(lLock == 0 || lFiring) return;
+
+	xyLoaderUpload(gvLoadBudget);
+	if(lAsyncDone == lAsyncTotal) lAsyncDone = lAsyncTotal = 0;
+	if(lFinished.size() == 0){
+		xyLoaderSweep();
+		return;
+	};
+
+	//The callback may start more loads
+	vector<xyLoadJob*> finished;
+	finished.swap(lFinished);
+	lFiring = 1;
+
+	for(int i = 0; i < finished.size(); i++){
+		//Without a callback, the job waits for loadResult()
+		if(lHasLoaded){
+			SQInteger top = sq_gettop(gvSquirrel);
+			sq_pushobject(gvSquirrel, lLoaded);
+			sq_pushroottable(gvSquirrel);
+			sq_pushinteger(gvSquirrel, finished[i]->handle);
+			sq_pushinteger(gvSquirrel, finished[i]->result);
+			sq_call(gvSquirrel, 3, SQFalse, SQTrue);
+			sq_settop(gvSquirrel, top);
+			xyLoaderSpend(finished[i]);
+		};
+		finished[i]->reported = 1;
+	};
+
+	lFiring = 0;
+	xyLoaderSweep();
+};
@@ -0,0 +1,73 @@
+/*=============*\
+| LOADER HEADER |
+\*=============*/
+
+#ifndef _LOADER_H_
+#define _LOADER_H_
+
+#include "main.h"
+
+//Background loading
+//
+//Decoding a file is done by a pool of worker
+//threads. Only creating the texture and adding
+//the asset to its list has to happen on the
+//main thread, since the renderer belongs to it,
+//and that is done a few assets at a time within
+//a time budget so a frame never stalls on a
+//long list.
+//
+//Jobs started from scripts with the async
+//loading functions are kept by the loader and
+//reported with the onLoaded() callback from
+//xyUpdate(). Jobs started by the engine itself
+//belong to whoever queued them.
+
+const int _LK_IMAGE = 0;
+const int _LK_SPRITE = 1;
+const int _LK_SOUND = 2;
+const int _LK_MUSIC = 3;
+
+const int _LJ_QUEUED = 0;	//Waiting for a worker
+const int _LJ_DECODED = 1;	//Ready to be added on the main thread
+const int _LJ_DONE = 2;		//Added to its list
+const int _LJ_FAILED = 3;
+
+struct xyLoadJob{
+	int kind;
+	string path;
+	bool keyed;				//Turn key into transparency
+	Uint32 key;
+	Uint32 w, h, mar, pad, frames;	//Sprite settings
+	int pvx, pvy;
+	bool async;				//Owned by the loader
+	Uint32 handle;			//Given to the script for async jobs
+	int state;
+	SDL_Surface* surf;		//Decoded pixels, until uploaded
+	Mix_Chunk* chunk;
+	Mix_Music* music;
+	Uint32 result;			//Index in its list once done
+	Uint64 decode;			//Microseconds spent decoding
+	Uint64 upload;			//Microseconds spent uploading
+	string error;			//Why it failed, printed from the main thread
+	bool spent;				//Async result was read or passed to onLoaded()
+	bool reported;			//Async job is no longer waiting for onLoaded()
+};
+
+extern Uint64 gvLoadBudget;	//Microseconds per frame for finishing async loads
+
+xyLoadJob* xyLoaderNewJob(int kind, const string& path);
+xyLoadJob* xyLoaderQueue(xyLoadJob* job);
+Uint32 xyLoaderUpload(Uint64 budget);
+bool xyLoaderBusy();
+void xyLoaderFree(xyLoadJob* job);
+void xyLoaderQuit();
+
+Uint32 xyLoadAsync(xyLoadJob* job);
+float xyLoadProgress(Uint32 handle);
+float xyLoadProgress();
+Uint32 xyLoadResult(Uint32 handle);
+void xySetLoadedFunc(HSQOBJECT func);
+void xyLoaderUpdate();
+
+#endif
@@ -23,7 +23,18 @@
 #include "binds.h"
 #include "text.h"
 #include "audio.h"
-
+#include "batch.h"
+#include "renderstate.h"
+#include "pacer.h"
+#include "capture.h"
+#include "loader.h"
+#include "pak.h"
+#include "cache.h"
+#include "bytecode.h"
+#include "module.h"
+
+static SDL_Surface* headSurface = 0; //What is drawn to when headless
+static bool loopRunning = 0; //The engine loop is running, see xyRun()
 
 /////////////////
 //MAIN FUNCTION//
@@ -32,6 +43,31 @@
 extern "C"
 #endif
 int main(int argc, char* argv[]){
+	//Headless mode has to be known before anything starts
+	for(int i = 1; i < argc; i++){
+		if(string(argv[i]) == "--headless") gvHeadless = 1;
+
+		//Packing a directory doesn't need anything started
+		if(string(argv[i]) == "--pack"){
+			if(i + 2 >= argc){
+				xyPrint(0, "Usage: --pack <directory> <file.brxpak>");
+				return 1;
+			};
+			return (xyPakBuild(argv[i + 1], argv[i + 2]) ? 0 : 1);
+		};
+
+		//Neither does compiling one's scripts
+		if(string(argv[i]) == "--compile"){
+			if(i + 1 >= argc){
+				xyPrint(0, "Usage: --compile <directory>");
+				return 1;
+			};
+			return (xyCompileDir(argv[i + 1]) ? 0 : 1);
+		};
+
+		if(string(argv[i]) == "--no-cache") gvScriptCache = false;
+	};
+
 	//Initiate everything
 	if(xyInit() == 0){
 		xyPrint(0, "Failed to initiate Brux!");
@@ -52,10 +88,14 @@ int main(int argc, char* argv[]){
 	//so skip it.
 		if(i != 0){
 			//Input file
+			//Options like --headless have no extension
+			size_t dot = curarg.find_last_of(".");
+			string ext = (dot != string::npos ? curarg.substr(dot) : "");
+
 			//If the file is long enough
 			if(curarg.length() > 4){
 				//If the input is a Squirrel file
-				if(curarg.substr(curarg.find_last_of(".")) == ".sq" || curarg.substr(curarg.find_last_of(".")) == ".nut" || curarg.substr(curarg.find_last_of(".")) == ".brx"){
+				if(ext == ".sq" || ext == ".nut" || ext == ".brx"){
 					//Check that the file really exists
 					if(xyFileExists(curarg.c_str())){
 						//All checks pass, assign the file
@@ -68,6 +108,15 @@ int main(int argc, char* argv[]){
 					};
 				};
 			};
+			//A pack holding the game
+			if(ext == ".brxpak" && xyPakMount(curarg)){
+				size_t found = curarg.find_last_of("/\\");
+				if(found != string::npos){
+					gvWorkDir = curarg.substr(0, found);
+					chdir(gvWorkDir.c_str());
+					xyPrint(0, "This is the working directory: %s", getcwd(0,0));
+				};
+			};
 		//Other arguments
 
 		if(curarg == "-f") SDL_SetWindowFullscreen(gvWindow, SDL_WINDOW_FULLSCREEN_DESKTOP);
@@ -81,11 +130,14 @@ int main(int argc, char* argv[]){
 	xyLoadCore(); //Squirrel-side definitions
 	if(xygapp != ""){
 		xyPrint(0, "Running %s...", xygapp.c_str());
-		sqstd_dofile(gvSquirrel, xygapp.c_str(), 0, 1);
+		xyDoFile(xygapp.c_str());
 	} else {
-		if(xyFileExists("test.nut")) sqstd_dofile(gvSquirrel, "test.nut", 0, 1);
+		if(xyFileExists("test.nut")) xyDoFile("test.nut");
 	};
 
+	//The script may have left the loop to the engine
+	if(xyLoopPending()) xyRun();
+
 	//End game
 	xyEnd();
 
@@ -107,6 +159,14 @@ int xyInit(){
 	xyPrint(0, "Initializing program...\n\n");
 	xyPrint(0, didwin);
 
+	//Without a display or sound card, SDL's dummy
+	//drivers stand in for the real ones
+	if(gvHeadless){
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+		SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+		xyPrint(0, "Running headless.");
+	};
+
 	//Initiate SDL
 	SDL_SetHint(SDL_HINT_XINPUT_ENABLED, "0");
 	if(SDL_Init(SDL_INIT_EVERYTHING) < 0){
@@ -114,39 +174,48 @@ int xyInit(){
 		return 0;
 	};
 
-	//Create window
-	gvWindow = SDL_CreateWindow("Brux Runtime Environment", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, gvScrW, gvScrH, SDL_WINDOW_RESIZABLE);
-	if(gvWindow == 0){
-		xyPrint(0, "Window could not be created! SDL Error: %s\n", SDL_GetError());
-		return 0;
+	if(gvHeadless){
+		//Draw into memory instead of a window
+		headSurface = SDL_CreateRGBSurfaceWithFormat(0, gvScrW, gvScrH, 32, SDL_PIXELFORMAT_ARGB8888);
+		if(headSurface != 0) gvRender = SDL_CreateSoftwareRenderer(headSurface);
 	} else {
+		//Create window
+		gvWindow = SDL_CreateWindow("Brux Runtime Environment", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, gvScrW, gvScrH, SDL_WINDOW_RESIZABLE);
+		if(gvWindow == 0){
+			xyPrint(0, "Window could not be created! SDL Error: %s\n", SDL_GetError());
+			return 0;
+		};
+
 		//Create renderer for window
 		gvRender = SDL_CreateRenderer(gvWindow, -1, SDL_RENDERER_ACCELERATED);
-		if(gvRender == 0){
-			xyPrint(0, "Renderer could not be created! SDL Error: %s\n", SDL_GetError());
-			return 0;
-		} else {
-			//Initialize renderer color
-			SDL_SetRenderDrawColor(gvRender, 0xFF, 0xFF, 0xFF, 0xFF);
+	};
 
-			//Initialize PNG loading
-			if(!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)){
-				xyPrint(0, "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
-				return 0;
-			};
+	if(gvRender == 0){
+		xyPrint(0, "Renderer could not be created! SDL Error: %s\n", SDL_GetError());
+		return 0;
+	};
 
-			//Set up the viewport
-			SDL_Rect screensize;
-			screensize.x = 0;
-			screensize.y = 0;
-			screensize.w = gvScrW;
-			screensize.h = gvScrH;
-			SDL_RenderSetViewport(gvRender, &screensize);
-			SDL_RenderSetLogicalSize(gvRender, gvScrW, gvScrH);
+	//Initialize draw color
+	xySetDrawColor(0xFFFFFFFF);
 
-		};
+	//Start timing frames
+	xyPacerInit();
+
+	//Initialize PNG loading
+	if(!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)){
+		xyPrint(0, "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
+		return 0;
 	};
 
+	//Set up the viewport
+	SDL_Rect screensize;
+	screensize.x = 0;
+	screensize.y = 0;
+	screensize.w = gvScrW;
+	screensize.h = gvScrH;
+	SDL_RenderSetViewport(gvRender, &screensize);
+	SDL_RenderSetLogicalSize(gvRender, gvScrW, gvScrH);
+
 	//Initialize audio
 	if(Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0){
 		xyPrint(0, "SDL_mixer could not initialize! SDL_mixer error: %s\n", Mix_GetError());
@@ -163,6 +232,7 @@ int xyInit(){
 
 	sqstd_register_mathlib(gvSquirrel);
 	sqstd_register_iolib(gvSquirrel);
+	sqstd_register_bloblib(gvSquirrel);
 	sq_setprintfunc(gvSquirrel, xyPrint, xyPrint);
 	sq_pushroottable(gvSquirrel);
 
@@ -175,13 +245,6 @@ int xyInit(){
 
 	xyPrint(0, "Squirrel initialized successfully!");
 
-	//Initiate other
-	vcTextures.push_back(0);
-	vcSprites.push_back(0);
-	vcSounds.push_back(0);
-	vcMusic.push_back(0);
-	vcFonts.push_back(0);
-
 	xyPrint(0, "\n================\n");
 
 	//Return success
@@ -194,20 +257,35 @@ void xyEnd(){
 
 	//Cleanup all resources
 	xyPrint(0, "Cleaning up all resources...");
-	for(int i = 0; i < vcTextures.size(); i++){
-		xyDeleteImage(i);
+	xyStopCapture();
+	xyLoaderQuit();
+	xyCacheClear(); //Free everything no matter who shares it
+	for(Uint32 i = 1; i < vcTilemaps.slots(); i++){
+		delete vcTilemaps[vcTilemaps.handleAt(i)];
 	};
 
-	for(int i = 0; i < vcSprites.size(); i++){
-		delete vcSprites[i];
+	for(Uint32 i = 1; i < vcTexts.slots(); i++){
+		delete vcTexts[vcTexts.handleAt(i)];
 	};
 
-	for(int i = 0; i < vcSounds.size(); i++){
-		xyDeleteSound(i);
+	for(Uint32 i = 1; i < vcEmitters.slots(); i++){
+		delete vcEmitters[vcEmitters.handleAt(i)];
 	};
 
-	for(int i = 0; i < vcMusic.size(); i++){
-		xyDeleteMusic(i);
+	for(Uint32 i = 1; i < vcSprites.slots(); i++){
+		delete vcSprites[vcSprites.handleAt(i)];
+	};
+
+	for(Uint32 i = 1; i < vcTextures.slots(); i++){
+		xyDeleteImage(vcTextures.handleAt(i));
+	};
+
+	for(Uint32 i = 1; i < vcSounds.slots(); i++){
+		xyDeleteSound(vcSounds.handleAt(i));
+	};
+
+	for(Uint32 i = 1; i < vcMusic.slots(); i++){
+		xyDeleteMusic(vcMusic.handleAt(i));
 	};
 
 	//Close Squirrel
@@ -215,16 +293,21 @@ void xyEnd(){
 	SQInteger garbage = sq_collectgarbage(gvSquirrel);
 	xyPrint(0, "Collected %i junk obects.", garbage);
 	sq_pop(gvSquirrel, 1);
+	xyModuleClear(); //Modules hold on to what they returned
 	sq_close(gvSquirrel);
 
 	//Close SDL
 	xyPrint(0, "Closing SDL...");
 	SDL_DestroyRenderer(gvRender);
-	SDL_DestroyWindow(gvWindow);
+	if(gvWindow != 0) SDL_DestroyWindow(gvWindow);
+	if(headSurface != 0) SDL_FreeSurface(headSurface);
 	IMG_Quit();
 	Mix_Quit();
 	SDL_Quit();
 
+	//Nothing reads from packs anymore
+	xyPakQuit();
+
 	//Close log file
 	xyPrint(0, "System closed successfully!");
 	gvLog.close();
@@ -271,10 +354,25 @@ void xyBindAllFunctions(HSQUIRRELVM v){
 	//Main
 	xyPrint(0, "Embedding main...");
 	xyBindFunc(v, sqUpdate, "update");
+	xyBindFunc(v, sqOnUpdate, "onUpdate", 2, ".c|o");
+	xyBindFunc(v, sqOnDraw, "onDraw", 2, ".c|o");
+	xyBindFunc(v, sqSetTickRate, "setTickRate", -2, ".nn");
+	xyBindFunc(v, sqRunLoop, "runLoop");
+	xyBindFunc(v, sqStopLoop, "stopLoop");
 	xyBindFunc(v, sqGetOS, "getOS");
+	xyBindFunc(v, sqLoadProgress, "loadProgress", -1, ".n");
+	xyBindFunc(v, sqLoadResult, "loadResult", 2, ".n");
+	xyBindFunc(v, sqOnLoaded, "onLoaded", 2, ".c|o");
+	xyBindFunc(v, sqSetLoadBudget, "setLoadBudget", 2, ".n");
+	xyBindFunc(v, sqIsHeadless, "isHeadless");
 	xyBindFunc(v, sqGetTicks, "getTicks");
 	xyBindFunc(v, sqGetFPS, "getFPS");
 	xyBindFunc(v, sqSetFPS, "setFPS", 2, ".n");
+	xyBindFunc(v, sqSetFrameMode, "setFrameMode", 2, ".n");
+	xyBindFunc(v, sqGetFrameTime, "getFrameTime");
+	xyBindFunc(v, sqStartCapture, "startCapture", 3, ".sn");
+	xyBindFunc(v, sqStopCapture, "stopCapture");
+	xyBindFunc(v, sqGetCaptureStats, "getCaptureStats");
 	xyBindFunc(v, sqSetWindowTitle, "setWindowTitle", 2, ".s");
 
 	//Graphics
@@ -283,28 +381,48 @@ void xyBindAllFunctions(HSQUIRRELVM v){
 	xyBindFunc(v, sqSetDrawTarget, "setDrawTarget", 2, ".n");
 	xyBindFunc(v, sqClearScreen, "clearScreen");
 	xyBindFunc(v, sqResetDrawTarget, "resetDrawTarget");
+	xyBindFunc(v, sqPushDrawTarget, "pushDrawTarget", 2, ".n");
+	xyBindFunc(v, sqPopDrawTarget, "popDrawTarget");
+	xyBindFunc(v, sqNewCanvas, "newCanvas", 3, ".nn");
+	xyBindFunc(v, sqFreeCanvas, "freeCanvas", 2, ".n");
 	xyBindFunc(v, sqDrawImage, "drawImage", 4, ".nnn");
 	xyBindFunc(v, sqSetDrawColor, "setDrawColor", 2, ".n");
+	xyBindFunc(v, sqSetBlendMode, "setBlendMode", 2, ".n");
 	xyBindFunc(v, sqLoadImage, "loadImage", 2, ".s");
 	xyBindFunc(v, sqLoadImageKeyed, "loadImageKey", 3, ".sn");
+	xyBindFunc(v, sqPreloadImages, "preloadImages", 2, ".a");
+	xyBindFunc(v, sqLoadImageAsync, "loadImageAsync", 2, ".s");
 	xyBindFunc(v, sqDrawImage, "drawImage", 4, ".inn");
 	xyBindFunc(v, sqSetBackgroundColor, "setBackgroundColor", 2, ".n");
 	xyBindFunc(v, sqSetScalingFilter, "setScalingFilter", 2, ".n|b");
 	xyBindFunc(v, sqSetResolution, "setResolution", 3, ".nn");
+	xyBindFunc(v, sqSetScreenMode, "setScreenMode", 2, ".n");
 	xyBindFunc(v, sqDrawCircle, "drawCircle", 5, ".nnnn|b");
 	xyBindFunc(v, sqDrawRect, "drawRect", 6, ".nnnnn|b");
 	xyBindFunc(v, sqDrawPoint, "drawPoint", 3, ".nn");
 	xyBindFunc(v, sqDrawLine, "drawLine", 5, ".nnnn");
 	xyBindFunc(v, sqDrawLineWide, "drawLineWide", 6, ".nnnnn");
+	xyBindFunc(v, sqDrawPolyline, "drawPolyline", -2, ".anb");
+	xyBindFunc(v, sqDrawPolygon, "drawPolygon", 3, ".ab");
+	xyBindFunc(v, sqGetBatchStats, "getBatchStats");
+	xyBindFunc(v, sqSetCamera, "setCamera", -3, ".nnnn");
+	xyBindFunc(v, sqPushCamera, "pushCamera");
+	xyBindFunc(v, sqPopCamera, "popCamera");
+	xyBindFunc(v, sqSetDrawLayer, "setDrawLayer", 2, ".n");
+	xyBindFunc(v, sqSetDrawDepth, "setDrawDepth", 2, ".n");
+	xyBindFunc(v, sqSetTextureSort, "setTextureSort", 2, ".b");
 
 	//Sprites
 	xyPrint(0, "Embedding sprites...");
 	xyBindFunc(v, sqSpriteName, "spriteName", 2, ".n");
 	xyBindFunc(v, sqNewSprite, "newSprite", 9, ".siiiiiii");
+	xyBindFunc(v, sqNewSpriteAsync, "newSpriteAsync", 9, ".siiiiiii");
 	xyBindFunc(v, sqDrawSprite, "drawSprite", 5, ".innn");
 	xyBindFunc(v, sqDrawSpriteEx, "drawSpriteEx", 10, ".innnninnn");
+	xyBindFunc(v, sqDrawSpriteBatch, "drawSpriteBatch", -3, ".ia|xi");
 	xyBindFunc(v, sqDeleteSprite, "deleteSprite", 2, ".i");
 	xyBindFunc(v, sqFindSprite, "findSprite", 2, ".s");
+	xyBindFunc(v, sqSetAtlas, "setAtlas", 2, ".i");
 
 	//Input
 	xyPrint(0, "Embedding input...");
@@ -350,11 +468,46 @@ void xyBindAllFunctions(HSQUIRRELVM v){
 	xyPrint(0, "Embedding text...");
 	xyBindFunc(v, sqNewFont, "newFont", 6, ".nnnnn");
 	xyBindFunc(v, sqDrawText, "drawText", 5, ".nnns");
+	xyBindFunc(v, sqNewText, "newText", 3, ".is");
+	xyBindFunc(v, sqSetText, "setText", 3, ".is");
+	xyBindFunc(v, sqDrawTextObj, "drawTextObj", 4, ".inn");
+	xyBindFunc(v, sqBakeText, "bakeText", 3, ".ib");
+	xyBindFunc(v, sqDeleteText, "deleteText", 2, ".i");
+
+	//Tilemaps
+	xyPrint(0, "Embedding tilemaps...");
+	xyBindFunc(v, sqLoadTilemap, "loadTilemap", 2, ".s");
+	xyBindFunc(v, sqDeleteTilemap, "deleteTilemap", 2, ".i");
+	xyBindFunc(v, sqTilemapLayer, "tilemapLayer", 3, ".is");
+	xyBindFunc(v, sqDrawTilemapLayer, "drawTilemapLayer", 5, ".ii|snn");
+	xyBindFunc(v, sqGetTile, "getTile", 5, ".iinn");
+	xyBindFunc(v, sqSetTile, "setTile", 6, ".iinnn");
+	xyBindFunc(v, sqSetTilemapCache, "setTilemapCache", 4, ".ii|sb");
+	xyBindFunc(v, sqSetChunkBudget, "setChunkBudget", 2, ".i");
+
+	//Particles
+	xyPrint(0, "Embedding particles...");
+	xyBindFunc(v, sqNewEmitter, "newEmitter", 2, ".i");
+	xyBindFunc(v, sqDeleteEmitter, "deleteEmitter", 2, ".i");
+	xyBindFunc(v, sqEmitterPos, "emitterPos", 4, ".inn");
+	xyBindFunc(v, sqEmitterRate, "emitterRate", 3, ".in");
+	xyBindFunc(v, sqEmitterLife, "emitterLife", 4, ".inn");
+	xyBindFunc(v, sqEmitterSpeed, "emitterSpeed", 6, ".innnn");
+	xyBindFunc(v, sqEmitterForce, "emitterForce", 5, ".innn");
+	xyBindFunc(v, sqEmitterFrames, "emitterFrames", 4, ".iii");
+	xyBindFunc(v, sqEmitterColor, "emitterColor", 4, ".iii");
+	xyBindFunc(v, sqEmitterLimit, "emitterLimit", 3, ".ii");
+	xyBindFunc(v, sqEmitterBurst, "emitterBurst", 3, ".ii");
+	xyBindFunc(v, sqEmitterClear, "emitterClear", 2, ".i");
+	xyBindFunc(v, sqEmitterCount, "emitterCount", 2, ".i");
+	xyBindFunc(v, sqDrawEmitter, "drawEmitter", 2, ".i");
 
 	//File IO
 	xyPrint(0, "Embedding file I/O...");
 	xyBindFunc(v, sqFileExists, "fileExists", 2, ".s");
 	xyBindFunc(v, sqImport, "import", 2, ".s");
+	xyBindFunc(v, sqReloadModule, "reloadModule", 2, ".s");
+	xyBindFunc(v, sqGetModules, "getModules");
 	xyBindFunc(v, sqDoNut, "donut", 2, ".s");
 	xyBindFunc(v, sqDecodeJSON, "jsonRead", 2, ".s");
 	xyBindFunc(v, sqGetDir, "getdir");
@@ -364,27 +517,45 @@ void xyBindAllFunctions(HSQUIRRELVM v){
 	xyBindFunc(v, sqFileWrite, "fileWrite", 3, ".ss");
 	xyBindFunc(v, sqFileAppend, "fileAppend", 3, ".ss");
 	xyBindFunc(v, sqFileRead, "fileRead", 2, ".s");
+	xyBindFunc(v, sqMountPak, "mountPak", 2, ".s");
 
 	//Audio
 	xyPrint(0, "Embedding audio...");
 	xyBindFunc(v, sqLoadMusic, "loadMusic", 2, ".s");
 	xyBindFunc(v, sqLoadSound, "loadSound", 2, ".s");
+	xyBindFunc(v, sqLoadMusicAsync, "loadMusicAsync", 2, ".s");
+	xyBindFunc(v, sqLoadSoundAsync, "loadSoundAsync", 2, ".s");
 	xyBindFunc(v, sqPlaySound, "playSound", 3, ".nn");
 	xyBindFunc(v, sqPlayMusic, "playMusic", 3, ".nn");
 	xyBindFunc(v, sqDeleteSound, "deleteSound", 2, ".n");
 	xyBindFunc(v, sqDeleteMusic, "deleteMusic", 2, ".n");
 };
 
+//Remember what input was down, so presses and releases
+//are seen by the next check and not the ones after it
+static void xyLatchInput(){
+	keylast = keystate;
+
+	for(int i = 0; i < 5; i++){
+		buttonlast[i] = buttonstate[i];
+	};
+
+	for(int i = 0; i < 8; i++){
+		gvPadHatLast[i] = gvPadHat[i];
+		for(int j = 0; j < 32; j++){
+			gvPadLastButton[i][j] = gvPadButton[i][j];
+		};
+	};
+};
+
 void xyUpdate(){
 	//Update ticks counter for FPS
 	gvTickLast = gvTicks;
 	gvTicks = SDL_GetTicks();
-	int fLength = gvTicks - gvTickLast;
+	gvFrame++;
 
-	//Update last button state
-	for(int i = 0; i < 5; i++){
-		buttonlast[i] = buttonstate[i];
-	};
+	//The engine loop does this once per tick instead
+	if(!loopRunning) xyLatchInput();
 
 	//Reset event-related globals
 	gvQuit = 0;
@@ -395,6 +566,13 @@ void xyUpdate(){
 		//Quit
 		if(Event.type == SDL_QUIT) gvQuit = 1;
 
+		//Cached tile chunks and baked text are lost with the render targets
+		if(Event.type == SDL_RENDER_TARGETS_RESET || Event.type == SDL_RENDER_DEVICE_RESET){
+			xyStateReset();
+			xyTilemapInvalidate();
+			xyTextInvalidate();
+		};
+
 		//Mouse button
 		if(Event.type == SDL_MOUSEBUTTONDOWN){
 			if(Event.button.button == SDL_BUTTON_LEFT) buttonstate[0] = 1;
@@ -414,15 +592,19 @@ void xyUpdate(){
 	};
 
 	//Update screen
-	SDL_RenderPresent(gvRender);
-	Uint32 olddraw = gvDrawColor;
-	xySetDrawColor(gvBackColor);
-	SDL_RenderClear(gvRender);
-	xySetDrawColor(olddraw);
-	if(SDL_BYTEORDER == SDL_LIL_ENDIAN) gvDrawColor = SDL_Swap32(gvDrawColor);
+	xyPresentScreen();
+	xyClearScreen();
+	xyBatchEndFrame();
+	xyStateEndFrame();
+
+	//Finish whatever loaded in the background
+	xyLoaderUpdate();
+
+	//Move particles along for the next frame. The
+	//engine loop moves them once per tick instead.
+	if(!loopRunning) xyUpdateEmitters();
 
 	//Update input
-	keylast = keystate;
 	SDL_PumpEvents();
 	for(int i = 0; i < 322; i++){
 		keystate[i] = sdlKeys[i];
@@ -431,18 +613,12 @@ void xyUpdate(){
 	SDL_GetMouseState(&gvMouseX, &gvMouseY);
 
 	for(int i = 0; i < 8; i++){
-		for(int j = 0; j < 32; j++){
-			gvPadLastButton[i][j] = gvPadButton[i][j];
-		};
-
 		if(SDL_JoystickGetAttached(gvGamepad[i])){
-			gvPadHatLast[i] = gvPadHat[i];
 			gvPadHat[i] = SDL_JoystickGetHat(gvGamepad[i], 0);
 			for(int j = 0; j < 10; j++){
 				gvPadAxis[i][j] = SDL_JoystickGetAxis(gvGamepad[i], j);
 			};
 			for(int j = 0; j < 32; j++){
-				gvPadLastButton[i][j] = gvPadButton[i][j];
 				gvPadButton[i][j] = SDL_JoystickGetButton(gvGamepad[i], j);
 			};
 			gvPadX[i] = SDL_JoystickGetAxis(gvGamepad[i], 0);
@@ -454,13 +630,11 @@ void xyUpdate(){
 			gvPadL[i] = (SDL_JoystickGetAxis(gvGamepad[i], 2) + 32768) / 2;
 			gvPadName[i] = SDL_JoystickName(gvGamepad[i]);
 		} else {
-			gvPadHatLast[i] = gvPadHat[i];
 			gvPadHat[i] = 0;
 			for(int j = 0; j < 10; j++){
 				gvPadAxis[i][j] = 0;
 			};
 			for(int j = 0; j < 32; j++){
-				gvPadLastButton[i][j] = gvPadButton[i][j];
 				gvPadButton[i][j] = 0;
 			};
 			gvPadX[i] = 0;
@@ -474,15 +648,18 @@ void xyUpdate(){
 		};
 	};
 
-	//Divide by scale
-	float sx, sy;
-	SDL_RenderGetScale(gvRender, &sx, &sy);
+	//Divide by scale, unless the framebuffer is
+	//shown and the mouse can be mapped onto it
+	if(!xyScreenMouse(&gvMouseX, &gvMouseY)){
+		float sx, sy;
+		SDL_RenderGetScale(gvRender, &sx, &sy);
 
-	if(sx == 0) sx = 1;
-	if(sy == 0) sy = 1;
+		if(sx == 0) sx = 1;
+		if(sy == 0) sy = 1;
 
-	gvMouseX /= sx;
-	gvMouseY /= sy;
+		gvMouseX /= sx;
+		gvMouseY /= sy;
+	};
 
 	//Gamepad
 	//Check each pad
@@ -490,19 +667,8 @@ void xyUpdate(){
 		if(SDL_NumJoysticks() > i) gvGamepad[i] = SDL_JoystickOpen(i);
 	};
 
-	gvFPS = 1000 / fLength;
-	//Wait for FPS limit
-	//		delay	4294967290	unsigned int
-	Uint32 current_time = (static_cast<Uint32>(fLength) / gvMaxFPS);
-	Uint32 max_delay = (1000 / gvMaxFPS);
-	if (current_time < max_delay) {
-		if (gvMaxFPS != 0) SDL_Delay(max_delay - current_time);
-	}
-	/*while(fLength < 1000 / gvMaxFPS){
-		gvTicks = SDL_GetTicks();
-		fLength = gvTicks - gvTickLast;
-	};*/
-	gvFPS = 1000 / fLength;
+	//Wait for the next frame
+	xyPacerWait();
 };
 
 int xyGetOS(){
@@ -520,6 +686,108 @@ int xyGetOS(){
 #endif
 };
 
+///////////////
+//ENGINE LOOP//
+///////////////
+
+//Instead of looping in the script, a game can hand
+//its update and draw functions to the engine. Updates
+//run at a fixed rate, catching up if frames take too
+//long, and drawing happens once per frame with how
+//far the next update is as a fraction, so positions
+//can be blended between ticks.
+
+static HSQOBJECT loopUpdate;
+static HSQOBJECT loopDraw;
+static bool loopHasUpdate = 0;
+static bool loopHasDraw = 0;
+static bool loopStarted = 0;			//The loop has run at least once
+static Uint64 loopTick = 1000000 / 60;	//Microseconds per update
+static Uint32 loopCatchUp = 5;			//Most updates run in one frame
+
+//Keep a closure around between frames, or let go of it with null
+static void xyLoopHold(HSQOBJECT* slot, bool* has, HSQOBJECT func){
+	if(*has) sq_release(gvSquirrel, slot);
+	*has = (sq_isclosure(func) || sq_isnativeclosure(func));
+	*slot = func;
+	if(*has) sq_addref(gvSquirrel, slot);
+};
+
+void xySetUpdateFunc(HSQOBJECT func){
+	xyLoopHold(&loopUpdate, &loopHasUpdate, func);
+};
+
+void xySetDrawFunc(HSQOBJECT func){
+	xyLoopHold(&loopDraw, &loopHasDraw, func);
+};
+
+void xySetTickRate(Uint32 rate, Uint32 catchup){
+	if(rate == 0) rate = 60;
+	loopTick = 1000000 / rate;
+	if(loopTick == 0) loopTick = 1;
+	loopCatchUp = (catchup > 0 ? catchup : 1);
+};
+
+void xyStopLoop(){
+	loopRunning = 0;
+};
+
+//The script set up callbacks but never started the loop
+bool xyLoopPending(){
+	return (loopHasUpdate || loopHasDraw) && !loopStarted;
+};
+
+//Call a held closure with one float. Returns false
+//if it threw, since it would only keep throwing.
+static bool xyLoopCall(HSQOBJECT func, SQFloat arg){
+	SQInteger top = sq_gettop(gvSquirrel);
+	sq_pushobject(gvSquirrel, func);
+	sq_pushroottable(gvSquirrel);
+	sq_pushfloat(gvSquirrel, arg);
+	bool ok = SQ_SUCCEEDED(sq_call(gvSquirrel, 2, SQFalse, SQTrue));
+	sq_settop(gvSquirrel, top);
+	return ok;
+};
+
 void xyRun(){
+	if(loopRunning || !(loopHasUpdate || loopHasDraw)) return;
+	loopRunning = 1;
+	loopStarted = 1;
+
+	Uint64 last = xyPacerNow();
+	Uint64 behind = 0;
+
+	while(loopRunning){
+		Uint64 now = xyPacerNow();
+		behind += xyPacerMicros(last, now);
+		last = now;
+
+		//Drop time that can't be caught up on
+		//rather than falling further behind
+		if(behind > loopTick * loopCatchUp) behind = loopTick * loopCatchUp;
+
+		while(behind >= loopTick && loopRunning){
+			behind -= loopTick;
+			if(loopHasUpdate && !xyLoopCall(loopUpdate, loopTick / 1000000.0)){
+				xyPrint(0, "Engine loop stopped after an error in onUpdate().");
+				loopRunning = 0;
+			};
+
+			//Particles move and presses are used up once per tick,
+			//no matter how many frames are drawn in between
+			xyUpdateEmitters();
+			xyLatchInput();
+		};
+		if(!loopRunning) break;
+
+		if(loopHasDraw && !xyLoopCall(loopDraw, (SQFloat)behind / loopTick)){
+			xyPrint(0, "Engine loop stopped after an error in onDraw().");
+			loopRunning = 0;
+		};
+
+		xyUpdate();
+		if(gvQuit) loopRunning = 0;
+	};
 
+	loopRunning = 0;
 };
@@ -58,6 +58,7 @@
 #include <Squirrel/sqstdmath.h>
 #include <Squirrel/sqstdstring.h>
 #include <Squirrel/sqstdsystem.h>
+#include <Squirrel/sqstdblob.h>
 #else
 #include <squirrel.h>
 #include <sqstdio.h>
@@ -65,6 +66,7 @@
 #include <sqstdmath.h>
 #include <sqstdstring.h>
 #include <sqstdsystem.h>
+#include <sqstdblob.h>
 #endif
 
 using namespace std;
@@ -80,6 +82,11 @@ using namespace std;
 int xyInit();
 void xyStart();
 void xyRun();
+void xySetUpdateFunc(HSQOBJECT func);
+void xySetDrawFunc(HSQOBJECT func);
+void xySetTickRate(Uint32 rate, Uint32 catchup);
+void xyStopLoop();
+bool xyLoopPending();
 void xyEnd();
 void xyPrint(HSQUIRRELVM v, const SQChar *s, ...);
 void xyBindFunc(HSQUIRRELVM v, SQFUNCTION func, const SQChar *key);
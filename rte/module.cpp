@@ -0,0 +1,167 @@
+/*=============*\
+| MODULE SOURCE |
+\*=============*/
+
+#include "main.h"
+#include "global.h"
+#include "fileio.h"
+#include "pacer.h"
+#include "bytecode.h"
+#include "module.h"
+#include <map>
+
+static map<string, xyModule> mModules;
+static vector<string> mStack;		//Modules running right now, innermost last
+static vector<Uint64> mNested;		//Time spent in each one's imports
+static Uint32 mOrder = 0;
+
+//"shapes", "shapes.nut" and "./shapes.nut" are all the same module
+string xyModuleName(const string& name){
+	string out = xyNormalPath(name);
+
+	size_t dot = out.find_last_of(".");
+	size_t slash = out.find_last_of("/");
+	string ext = (dot != string::npos && (slash == string::npos || dot > slash) ? out.substr(dot) : "");
+	if(ext != ".nut" && ext != ".sq" && ext != ".brx") out += ".nut";
+
+	return out;
+};
+
+static void xyModuleForget(xyModule& mod){
+	if(mod.state == _MS_LOADED) sq_release(gvSquirrel, &mod.value);
+	sq_resetobject(&mod.value);
+};
+
+//Push a module's value, running it first if it
+//hasn't been yet. Pushes null if it failed.
+bool xyImport(HSQUIRRELVM v, const string& name){
+	string key = xyModuleName(name);
+
+	//Whoever is running now depends on this one
+	if(mStack.size() > 0){
+		vector<string>& deps = mModules[mStack.back()].deps;
+		if(find(deps.begin(), deps.end(), key) == deps.end()) deps.push_back(key);
+	};
+
+	map<string, xyModule>::iterator it = mModules.find(key);
+	if(it != mModules.end()){
+		if(it->second.state == _MS_LOADED){
+			sq_pushobject(v, it->second.value);
+			return true;
+		};
+
+		//It's still running further up, so it has no value yet
+		if(it->second.state == _MS_LOADING){
+			xyPrint(0, "Circular import of %s!", key.c_str());
+			sq_pushnull(v);
+			return false;
+		};
+	};
+
+	xyModule& mod = mModules[key];
+	if(it == mModules.end()){
+		mod.state = _MS_STALE;
+		mod.order = 0;
+	};
+	xyModuleForget(mod);
+	mod.name = key;
+	mod.path = gvAppDir + "xylib/" + key;
+	mod.state = _MS_LOADING;
+	mod.deps.clear();
+
+	mStack.push_back(key);
+	mNested.push_back(0);
+	Uint64 start = xyPacerNow();
+
+	bool ok = xyLoadScript(v, mod.path.c_str());
+	if(ok){
+		sq_pushroottable(v);
+		ok = SQ_SUCCEEDED(sq_call(v, 1, SQTrue, SQTrue));
+		if(ok){
+			sq_getstackobj(v, -1, &mod.value);
+			sq_addref(v, &mod.value);
+			sq_pop(v, 1);
+		};
+		sq_pop(v, 1);
+	};
+
+	mod.time = xyPacerMicros(start, xyPacerNow());
+	mod.self = mod.time - mNested.back();
+	mStack.pop_back();
+	mNested.pop_back();
+	if(mNested.size() > 0) mNested.back() += mod.time;
+
+	if(!ok){
+		xyPrint(0, "Unable to import %s!", key.c_str());
+		mod.state = _MS_FAILED;
+		sq_pushnull(v);
+		return false;
+	};
+
+	mod.state = _MS_LOADED;
+	mod.order = mOrder++;
+	sq_pushobject(v, mod.value);
+	return true;
+};
+
+//Run a module again, and everything that imported it
+bool xyReloadModule(HSQUIRRELVM v, const string& name){
+	string key = xyModuleName(name);
+	if(mModules.find(key) == mModules.end()) return false;
+
+	//Go up the graph from the module to its dependents
+	vector<string> stale(1, key);
+	for(int i = 0; i < stale.size(); i++){
+		for(map<string, xyModule>::iterator it = mModules.begin(); it != mModules.end(); ++it){
+			const vector<string>& deps = it->second.deps;
+			if(find(deps.begin(), deps.end(), stale[i]) == deps.end()) continue;
+			if(find(stale.begin(), stale.end(), it->first) == stale.end()) stale.push_back(it->first);
+		};
+	};
+
+	//Nothing can be reloaded while one of them is still running
+	for(int i = 0; i < stale.size(); i++){
+		if(mModules[stale[i]].state == _MS_LOADING) return false;
+	};
+
+	//Dependencies always finished loading first
+	vector<pair<Uint32, string> > order;
+	for(int i = 0; i < stale.size(); i++){
+		xyModule& mod = mModules[stale[i]];
+		order.push_back(make_pair(mod.order, stale[i]));
+		xyModuleForget(mod);
+		mod.state = _MS_STALE;
+	};
+	sort(order.begin(), order.end());
+
+	//Importing one may already have run the next
+	bool ok = true;
+	for(int i = 0; i < order.size(); i++){
+		if(!xyImport(v, order[i].second)) ok = false;
+		sq_pop(v, 1);
+	};
+
+	return ok;
+};
+
+//Modules in the order they finished loading
+void xyListModules(vector<const xyModule*>& out){
+	vector<pair<Uint32, const xyModule*> > order;
+	for(map<string, xyModule>::iterator it = mModules.begin(); it != mModules.end(); ++it){
+		Uint32 at = (it->second.state == _MS_LOADED ? it->second.order : 0xFFFFFFFF);
+		order.push_back(make_pair(at, &it->second));
+	};
+	sort(order.begin(), order.end());
+
+	out.clear();
+	for(int i = 0; i < order.size(); i++) out.push_back(order[i].second);
+};
+
+//Has to happen before the VM is closed
+void xyModuleClear(){
+	for(map<string, xyModule>::iterator it = mModules.begin(); it != mModules.end(); ++it) xyModuleForget(it->second);
+	mModules.clear();
+	mStack.clear();
+	mNested.clear();
+	mOrder = 0;
+};
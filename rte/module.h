@@ -0,0 +1,48 @@
+/*=============*\
+| MODULE HEADER |
+\*=============*/
+
+#ifndef _MODULE_H_
+#define _MODULE_H_
+
+#include "main.h"
+
+//Modules
+//
+//Libraries in xylib are loaded with import(), and
+//each one only runs the first time it's imported.
+//After that, import() gives back whatever the
+//module returned when it ran, so a library shared
+//by several others doesn't run again and reset its
+//own state. Modules still run in the root table,
+//so the globals they declare work like before.
+//
+//Every import made while a module is running is
+//recorded as one of its dependencies, along with
+//how long each module took to load. Reloading a
+//module runs it again, then every module that
+//depends on it, in the order they first loaded.
+
+const int _MS_LOADING = 0;
+const int _MS_LOADED = 1;
+const int _MS_FAILED = 2;
+const int _MS_STALE = 3;		//Will run again on the next import
+
+struct xyModule{
+	string name;			//Path under xylib, with its extension
+	string path;
+	int state;
+	HSQOBJECT value;		//What the module returned
+	vector<string> deps;	//Modules it imported
+	Uint64 time;			//Microseconds to load, with its imports
+	Uint64 self;			//Without them
+	Uint32 order;			//When it finished loading
+};
+
+string xyModuleName(const string& name);
+bool xyImport(HSQUIRRELVM v, const string& name);
+bool xyReloadModule(HSQUIRRELVM v, const string& name);
+void xyListModules(vector<const xyModule*>& out);
+void xyModuleClear();
+
+#endif
@@ -0,0 +1,98 @@
+/*============*\
+| PACER SOURCE |
+\*============*/
+
+#include "main.h"
+#include "global.h"
+#include "pacer.h"
+
+static int pMode = _PM_SLEEP;
+static Uint64 pFreq = 1;		//Counter ticks per second
+static Uint64 pPeriod = 0;		//Counter ticks per frame, 0 when there is no limit
+static Uint64 pDeadline = 0;	//When the next frame should start
+static Uint64 pLast = 0;		//When the last frame started
+static Uint64 pSpin = 2000;		//Microseconds left to spin after sleeping
+static const Uint64 pSpinMin = 1000, pSpinMax = 8000;
+
+void xyPacerInit(){
+	pFreq = SDL_GetPerformanceFrequency();
+	if(pFreq == 0) pFreq = 1;
+	pLast = SDL_GetPerformanceCounter();
+	pDeadline = pLast;
+
+	xyPacerSetRate(gvMaxFPS);
+	if(gvHeadless) pMode = _PM_UNCAPPED;
+};
+
+void xyPacerSetMode(int mode){
+	if(mode < _PM_VSYNC || mode > _PM_UNCAPPED) mode = _PM_SLEEP;
+
+	//Nobody is watching, so run as fast as possible
+	if(gvHeadless) mode = _PM_UNCAPPED;
+
+	//Not every renderer can turn vsync on or off later
+	if(gvRender != 0 && SDL_RenderSetVSync(gvRender, mode == _PM_VSYNC) != 0){
+		if(mode == _PM_VSYNC){
+			xyPrint(0, "Unable to turn on vsync! SDL Error: %s\n", SDL_GetError());
+			mode = _PM_SLEEP;
+		};
+	};
+
+	pMode = mode;
+	pDeadline = SDL_GetPerformanceCounter();
+};
+
+int xyPacerGetMode(){
+	return pMode;
+};
+
+void xyPacerSetRate(Uint32 fps){
+	gvMaxFPS = fps;
+	if(fps == 0) pPeriod = 0;
+	else pPeriod = pFreq / fps;
+	pDeadline = SDL_GetPerformanceCounter();
+};
+
+Uint64 xyPacerNow(){
+	return SDL_GetPerformanceCounter();
+};
+
+Uint64 xyPacerMicros(Uint64 from, Uint64 to){
+	if(to <= from) return 0;
+	return ((to - from) * 1000000) / pFreq;
+};
+
+//Called at the end of each frame, after presenting
+void xyPacerWait(){
+	Uint64 now = SDL_GetPerformanceCounter();
+
+	if(pMode == _PM_SLEEP && pPeriod > 0){
+		pDeadline += pPeriod;
+
+		//Too far behind to catch up, so start over from
+		//now instead of rushing through several frames
+		if(now > pDeadline + pPeriod) pDeadline = now;
+
+		while(now < pDeadline){
+			Uint64 left = xyPacerMicros(now, pDeadline);
+			if(left > pSpin){
+				Uint32 ms = (left - pSpin) / 1000;
+				Uint64 slept = now;
+				SDL_Delay(ms);
+				now = SDL_GetPerformanceCounter();
+
+				//Leave more room to spin when the system
+				//oversleeps, and slowly less when it doesn't
+				Uint64 over = xyPacerMicros(slept, now);
+				over = (over > ms * 1000 ? over - (ms * 1000) : 0);
+				if(over + 500 > pSpin) pSpin = min(over + 500, pSpinMax);
+				else if(pSpin > pSpinMin) pSpin -= (pSpin - pSpinMin) / 64 + 1;
+			} else now = SDL_GetPerformanceCounter();
+		};
+	} else pDeadline = now;
+
+	//Time from the start of the last frame to this one
+	gvFrameTime = xyPacerMicros(pLast, now);
+	pLast = now;
+	if(gvFrameTime > 0) gvFPS = 1000000.0 / gvFrameTime;
+};
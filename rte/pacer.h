@@ -0,0 +1,34 @@
+/*============*\
+| PACER HEADER |
+\*============*/
+
+#ifndef _PACER_H_
+#define _PACER_H_
+
+#include "main.h"
+
+//Frame pacing
+//
+//Frames are timed with the performance
+//counter instead of SDL_GetTicks(), which
+//only counts whole milliseconds.
+//
+//In the sleep mode, each frame has a deadline
+//one period after the last one. The thread
+//sleeps until it is close, since SDL_Delay()
+//can oversleep by a millisecond or two, and
+//then spins the rest of the way.
+
+const int _PM_VSYNC = 0;		//Wait for the display when presenting
+const int _PM_SLEEP = 1;		//Sleep, then spin to gvMaxFPS
+const int _PM_UNCAPPED = 2;		//Don't wait at all
+
+void xyPacerInit();
+void xyPacerSetMode(int mode);
+int xyPacerGetMode();
+void xyPacerSetRate(Uint32 fps);
+void xyPacerWait();
+Uint64 xyPacerNow();
+Uint64 xyPacerMicros(Uint64 from, Uint64 to);
+
+#endif
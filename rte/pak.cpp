@@ -0,0 +1,305 @@
+/*==========*\
+| PAK SOURCE |
+\*==========*/
+
+#include "main.h"
+#include "global.h"
+#include "fileio.h"
+#include "pak.h"
+
+#ifndef _WIN32
+	#include <sys/mman.h>
+	#include <fcntl.h>
+#endif
+
+struct xyPak{
+	string file;
+	const Uint8* data;			//The whole mapped file
+	Uint64 size;
+	const xyPakEntry* index;
+	const char* names;
+	Uint32 count;
+};
+
+//A fixed list, so loader threads looking through it
+//never see it move while a pack is being mounted
+static xyPak pPaks[_PAK_MAX];
+static int pCount = 0;
+
+static Uint64 xyPakHash(const string& name){
+	return xyHashBytes(name.data(), name.size());
+};
+
+static Uint64 xyPakAlign(Uint64 pos){
+	return (pos + _PAK_ALIGN - 1) & ~(Uint64)(_PAK_ALIGN - 1);
+};
+
+static bool xyPakMap(const string& file, xyPak& pak){
+#ifdef _WIN32
+	HANDLE f = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(f == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(f, &size) || size.QuadPart == 0){
+		CloseHandle(f);
+		return false;
+	};
+
+	//The view keeps the file open by itself
+	HANDLE map = CreateFileMappingA(f, 0, PAGE_READONLY, 0, 0, 0);
+	CloseHandle(f);
+	if(map == 0) return false;
+
+	pak.data = (const Uint8*)MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(map);
+	if(pak.data == 0) return false;
+	pak.size = size.QuadPart;
+#else
+	int fd = open(file.c_str(), O_RDONLY);
+	if(fd < 0) return false;
+
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size == 0){
+		close(fd);
+		return false;
+	};
+
+	void* data = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED) return false;
+
+	pak.data = (const Uint8*)data;
+	pak.size = info.st_size;
+#endif
+
+	return true;
+};
+
+static void xyPakUnmap(xyPak& pak){
+	if(pak.data == 0) return;
+#ifdef _WIN32
+	UnmapViewOfFile(pak.data);
+#else
+	munmap((void*)pak.data, pak.size);
+#endif
+	pak.data = 0;
+};
+
+//Make sure nothing in the index points outside the file
+static bool xyPakCheck(xyPak& pak){
+	if(pak.size < sizeof(xyPakHeader)) return false;
+
+	const xyPakHeader* head = (const xyPakHeader*)pak.data;
+	if(memcmp(head->magic, "BRXP", 4) != 0) return false;
+	if(SDL_SwapLE32(head->version) != _PAK_VERSION) return false;
+
+	pak.count = SDL_SwapLE32(head->count);
+	Uint64 names = sizeof(xyPakHeader) + ((Uint64)pak.count * sizeof(xyPakEntry));
+	Uint64 namesize = SDL_SwapLE32(head->names);
+	if(names + namesize > pak.size) return false;
+
+	pak.index = (const xyPakEntry*)(pak.data + sizeof(xyPakHeader));
+	pak.names = (const char*)(pak.data + names);
+
+	for(Uint32 i = 0; i < pak.count; i++){
+		Uint64 offset = SDL_SwapLE64(pak.index[i].offset);
+		Uint64 size = SDL_SwapLE64(pak.index[i].size);
+		if(offset > pak.size || size > pak.size - offset) return false;
+		if((Uint64)SDL_SwapLE32(pak.index[i].name) + SDL_SwapLE32(pak.index[i].length) > namesize) return false;
+	};
+
+	return true;
+};
+
+//Packs should be mounted before anything is loaded from them
+bool xyPakMount(const string& file){
+	if(pCount == _PAK_MAX){
+		xyPrint(0, "Unable to mount %s! Only %d packs can be mounted.", file.c_str(), _PAK_MAX);
+		return false;
+	};
+
+	xyPak pak;
+	pak.file = file;
+	pak.data = 0;
+	pak.size = 0;
+	pak.index = 0;
+	pak.names = 0;
+	pak.count = 0;
+
+	if(!xyPakMap(file, pak)){
+		xyPrint(0, "Unable to open pack %s!", file.c_str());
+		return false;
+	};
+
+	if(!xyPakCheck(pak)){
+		xyPrint(0, "%s is not a valid pack!", file.c_str());
+		xyPakUnmap(pak);
+		return false;
+	};
+
+	pPaks[pCount] = pak;
+	pCount++;
+
+	xyPrint(0, "Mounted %s with %u files.", file.c_str(), pak.count);
+	return true;
+};
+
+//Only safe once nothing loaded from a pack is left,
+//since music keeps reading from it while it plays
+void xyPakQuit(){
+	for(int i = 0; i < pCount; i++) xyPakUnmap(pPaks[i]);
+	pCount = 0;
+};
+
+//Point to a file's data inside the mapping
+bool xyPakFind(const string& path, const Uint8** data, Uint64* size){
+	if(pCount == 0) return false;
+
+	string name = xyNormalPath(path);
+	Uint64 hash = xyPakHash(name);
+
+	for(int p = pCount - 1; p >= 0; p--){
+		const xyPak& pak = pPaks[p];
+
+		//Find the first entry with this hash
+		Uint32 lo = 0, hi = pak.count;
+		while(lo < hi){
+			Uint32 mid = lo + ((hi - lo) / 2);
+			if(SDL_SwapLE64(pak.index[mid].hash) < hash) lo = mid + 1;
+			else hi = mid;
+		};
+
+		//Paths with the same hash are next to each other
+		for(Uint32 i = lo; i < pak.count && SDL_SwapLE64(pak.index[i].hash) == hash; i++){
+			const xyPakEntry& entry = pak.index[i];
+			if(SDL_SwapLE32(entry.length) != name.size()) continue;
+			if(memcmp(pak.names + SDL_SwapLE32(entry.name), name.data(), name.size()) != 0) continue;
+
+			*data = pak.data + SDL_SwapLE64(entry.offset);
+			*size = SDL_SwapLE64(entry.size);
+			return true;
+		};
+	};
+
+	return false;
+};
+
+//Open a file for SDL to read, loose first and then
+//from the packs. Packed files are read in place.
+SDL_RWops* xyOpenAsset(const char* path){
+	SDL_RWops* rw = SDL_RWFromFile(path, "rb");
+	if(rw != 0) return rw;
+
+	const Uint8* data;
+	Uint64 size;
+	if(xyPakFind(path, &data, &size)) return SDL_RWFromConstMem(data, size);
+
+	SDL_SetError("Couldn't open %s", path);
+	return 0;
+};
+
+bool xyAssetInPak(const char* path){
+	const Uint8* data;
+	Uint64 size;
+	return xyPakFind(path, &data, &size);
+};
+
+////////////
+//PACKING//
+///////////{
+
+//Pack every file under dir, except other packs
+bool xyPakBuild(const string& dir, const string& out){
+	vector<string> all, files;
+	xyListFiles(dir, all);
+	for(int i = 0; i < all.size(); i++){
+		if(all[i].size() < 7 || all[i].substr(all[i].size() - 7) != ".brxpak") files.push_back(all[i]);
+	};
+
+	if(files.size() == 0){
+		xyPrint(0, "Nothing to pack in %s!", dir.c_str());
+		return false;
+	};
+
+	//Sorted by hash so lookups can search the index
+	vector<pair<Uint64, string> > order;
+	for(int i = 0; i < files.size(); i++){
+		string name = xyNormalPath(files[i]);
+		order.push_back(make_pair(xyPakHash(name), name));
+	};
+	sort(order.begin(), order.end());
+
+	vector<xyPakEntry> index(order.size());
+	string names;
+	for(int i = 0; i < order.size(); i++){
+		index[i].hash = order[i].first;
+		index[i].name = names.size();
+		index[i].length = order[i].second.size();
+		names += order[i].second;
+	};
+
+	Uint64 pos = xyPakAlign(sizeof(xyPakHeader) + (index.size() * sizeof(xyPakEntry)) + names.size());
+	for(int i = 0; i < index.size(); i++){
+		struct stat info;
+		if(stat((dir + "/" + order[i].second).c_str(), &info) != 0){
+			xyPrint(0, "Unable to read %s!", order[i].second.c_str());
+			return false;
+		};
+
+		index[i].offset = pos;
+		index[i].size = info.st_size;
+		pos = xyPakAlign(pos + info.st_size);
+	};
+
+	ofstream f(out.c_str(), ios::out | ios::binary);
+	if(!f.is_open()){
+		xyPrint(0, "Unable to write %s!", out.c_str());
+		return false;
+	};
+
+	xyPakHeader head;
+	memcpy(head.magic, "BRXP", 4);
+	head.version = SDL_SwapLE32(_PAK_VERSION);
+	head.count = SDL_SwapLE32(index.size());
+	head.names = SDL_SwapLE32(names.size());
+	f.write((const char*)&head, sizeof(head));
+
+	for(int i = 0; i < index.size(); i++){
+		xyPakEntry entry;
+		entry.hash = SDL_SwapLE64(index[i].hash);
+		entry.offset = SDL_SwapLE64(index[i].offset);
+		entry.size = SDL_SwapLE64(index[i].size);
+		entry.name = SDL_SwapLE32(index[i].name);
+		entry.length = SDL_SwapLE32(index[i].length);
+		f.write((const char*)&entry, sizeof(entry));
+	};
+	f.write(names.data(), names.size());
+
+	//Each file starts on the next boundary
+	Uint64 at = sizeof(xyPakHeader) + (index.size() * sizeof(xyPakEntry)) + names.size();
+	for(int i = 0; i < index.size(); i++){
+		for(; at < index[i].offset; at++) f.put(0);
+
+		ifstream t((dir + "/" + order[i].second).c_str(), ios::in | ios::binary);
+		string data(index[i].size, 0);
+		if(data.size() > 0) t.read(&data[0], data.size());
+		if(!t){
+			xyPrint(0, "Unable to read %s!", order[i].second.c_str());
+			return false;
+		};
+
+		f.write(data.data(), data.size());
+		at += data.size();
+	};
+
+	f.close();
+	if(f.fail()){
+		xyPrint(0, "Unable to write %s!", out.c_str());
+		return false;
+	};
+
+	xyPrint(0, "Packed %d files into %s (%d KB).", (int)index.size(), out.c_str(), (int)(at / 1024));
+	return true;
+};
+
+//}
@@ -0,0 +1,52 @@
+/*==========*\
+| PAK HEADER |
+\*==========*/
+
+#ifndef _PAK_H_
+#define _PAK_H_
+
+#include "main.h"
+
+//Asset packs
+//
+//A .brxpak holds a whole game directory in one
+//file. It starts with a header, then an index of
+//every file sorted by the hash of its path, then
+//the paths themselves, then each file's data on
+//a 16 byte boundary. Numbers are little endian.
+//
+//Packs are mapped into memory once when they are
+//mounted, and files are read straight out of the
+//mapping. A loose file with the same path always
+//wins over the packed one, so single files can
+//still be swapped out while working on a game.
+//Packs mounted later win over earlier ones.
+
+const Uint32 _PAK_VERSION = 1;
+const Uint32 _PAK_ALIGN = 16;
+const int _PAK_MAX = 16;
+
+struct xyPakHeader{
+	char magic[4];		//"BRXP"
+	Uint32 version;
+	Uint32 count;		//Number of files
+	Uint32 names;		//Bytes of paths after the index
+};
+
+struct xyPakEntry{
+	Uint64 hash;		//FNV-1a of the path
+	Uint64 offset;		//From the start of the pack
+	Uint64 size;
+	Uint32 name;		//Offset of the path in the path table
+	Uint32 length;		//Length of the path
+};
+
+bool xyPakMount(const string& file);
+void xyPakQuit();
+bool xyPakFind(const string& path, const Uint8** data, Uint64* size);
+bool xyPakBuild(const string& dir, const string& out);
+
+SDL_RWops* xyOpenAsset(const char* path);
+bool xyAssetInPak(const char* path);
+
+#endif
@@ -0,0 +1,249 @@
+/*================*\
+| PARTICLES SOURCE |
+\*================*/
+
+#include "main.h"
+#include "global.h"
+#include "graphics.h"
+#include "sprite.h"
+#include "batch.h"
+#include "particles.h"
+
+//Colors come in as 0xRRGGBBAA like setDrawColor()
+static SDL_Color xyColorFromInt(Uint32 c){
+	SDL_Color color = {(Uint8)(c >> 24), (Uint8)(c >> 16), (Uint8)(c >> 8), (Uint8)c};
+	return color;
+};
+
+//Random float between a and b
+static float xyRandomRange(float a, float b){
+	return a + ((b - a) * (rand() / (float)RAND_MAX));
+};
+
+xyEmitter::xyEmitter(Uint32 _sprite){
+	sprite = _sprite;
+	live = 0;
+
+	x = y = 0;
+	rate = 0;
+	pending = 0;
+	lifeMin = lifeMax = 60;
+	speedMin = speedMax = 1;
+	angle = 0;
+	spread = 360;
+	gx = gy = 0;
+	drag = 1;
+	frameFirst = frameLast = 0;
+	colorStart = colorEnd = xyColorFromInt(0xFFFFFFFF);
+	limit = 100000;
+
+	//Add to the list
+	numero = vcEmitters.add(this);
+};
+
+xyEmitter::~xyEmitter(){
+	//Remove from list
+	vcEmitters.remove(numero);
+};
+
+Uint32 xyEmitter::getnum(){
+	return numero;
+};
+
+Uint32 xyEmitter::getcount(){
+	return live;
+};
+
+void xyEmitter::setPos(float _x, float _y){
+	x = _x;
+	y = _y;
+};
+
+void xyEmitter::setRate(float _rate){
+	rate = (_rate > 0 ? _rate : 0);
+};
+
+void xyEmitter::setLife(float _min, float _max){
+	if(_min < 1) _min = 1;
+	if(_max < _min) _max = _min;
+	lifeMin = _min;
+	lifeMax = _max;
+};
+
+void xyEmitter::setSpeed(float _min, float _max, float _angle, float _spread){
+	speedMin = _min;
+	speedMax = _max;
+	angle = _angle;
+	spread = _spread;
+};
+
+void xyEmitter::setForce(float _gx, float _gy, float _drag){
+	gx = _gx;
+	gy = _gy;
+	drag = _drag;
+};
+
+void xyEmitter::setFrames(int first, int last){
+	frameFirst = first;
+	frameLast = (last < first ? first : last);
+};
+
+void xyEmitter::setColor(Uint32 start, Uint32 end){
+	colorStart = xyColorFromInt(start);
+	colorEnd = xyColorFromInt(end);
+};
+
+void xyEmitter::setLimit(Uint32 _limit){
+	limit = _limit;
+	if(live > limit) live = limit;
+};
+
+void xyEmitter::burst(Uint32 count){
+	spawn(count);
+};
+
+void xyEmitter::clear(){
+	live = 0;
+	pending = 0;
+};
+
+//Add particles at the emitter, going off within
+//spread degrees of the emitter's angle
+void xyEmitter::spawn(Uint32 count){
+	if(live + count > limit) count = limit - live;
+	if(count == 0) return;
+
+	Uint32 need = live + count;
+	if(px.size() < need){
+		px.resize(need);
+		py.resize(need);
+		vx.resize(need);
+		vy.resize(need);
+		life.resize(need);
+		span.resize(need);
+	};
+
+	for(Uint32 i = live; i < need; i++){
+		float a = (angle + xyRandomRange(-spread / 2, spread / 2)) * (pi / 180.0);
+		float s = xyRandomRange(speedMin, speedMax);
+		float l = xyRandomRange(lifeMin, lifeMax);
+
+		px[i] = x;
+		py[i] = y;
+		vx[i] = cos(a) * s;
+		vy[i] = sin(a) * s;
+		life[i] = l;
+		span[i] = 1.0 / l;
+	};
+
+	live = need;
+};
+
+void xyEmitter::update(){
+	//Emit at the set rate, carrying fractions over
+	pending += rate;
+	if(pending >= 1){
+		Uint32 count = pending;
+		pending -= count;
+		spawn(count);
+	};
+
+	if(live == 0) return;
+	Uint32 n = live;
+	float* fpx = &px[0];
+	float* fpy = &py[0];
+	float* fvx = &vx[0];
+	float* fvy = &vy[0];
+	float* fl = &life[0];
+
+	//One simple loop per step so each one vectorizes
+	for(Uint32 i = 0; i < n; i++) fvx[i] = (fvx[i] + gx) * drag;
+	for(Uint32 i = 0; i < n; i++) fvy[i] = (fvy[i] + gy) * drag;
+	for(Uint32 i = 0; i < n; i++) fpx[i] += fvx[i];
+	for(Uint32 i = 0; i < n; i++) fpy[i] += fvy[i];
+	for(Uint32 i = 0; i < n; i++) fl[i] -= 1;
+
+	//Move the last live particle into each dead one's place
+	for(Uint32 i = 0; i < n;){
+		if(fl[i] > 0){
+			i++;
+			continue;
+		};
+
+		n--;
+		fpx[i] = fpx[n];
+		fpy[i] = fpy[n];
+		fvx[i] = fvx[n];
+		fvy[i] = fvy[n];
+		fl[i] = fl[n];
+		span[i] = span[n];
+	};
+	live = n;
+};
+
+//Draw every particle as one batched draw. The frame
+//and color are picked by how far along its life each
+//particle is.
+void xyEmitter::draw(){
+	static vector<SDL_Vertex> verts;
+	static vector<SDL_Rect> frames;
+
+	if(live == 0) return;
+	xySprite* spr = vcSprites[sprite];
+	if(spr == 0) return;
+
+	SDL_Texture* tex = vcTextures[spr->gettex()];
+	if(tex == 0) return;
+
+	int tw = 1, th = 1;
+	SDL_QueryTexture(tex, 0, 0, &tw, &th);
+	if(tw <= 0) tw = 1;
+	if(th <= 0) th = 1;
+
+	//Look the frames up once for the whole emitter
+	int nframes = frameLast - frameFirst + 1;
+	frames.resize(nframes);
+	for(int i = 0; i < nframes; i++) spr->getFrame(frameFirst + i, &frames[i]);
+
+	float w = spr->getw(), h = spr->geth();
+	float ox = spr->getpvx(), oy = spr->getpvy();
+
+	verts.resize(live * 4);
+	SDL_Vertex* v = &verts[0];
+	for(Uint32 i = 0; i < live; i++){
+		//How far along its life, from 0 to 1
+		float age = 1.0 - (life[i] * span[i]);
+		if(age < 0) age = 0;
+		if(age > 1) age = 1;
+
+		int f = age * nframes;
+		if(f >= nframes) f = nframes - 1;
+		const SDL_Rect& rec = frames[f];
+
+		SDL_Color c;
+		c.r = colorStart.r + ((colorEnd.r - colorStart.r) * age);
+		c.g = colorStart.g + ((colorEnd.g - colorStart.g) * age);
+		c.b = colorStart.b + ((colorEnd.b - colorStart.b) * age);
+		c.a = colorStart.a + ((colorEnd.a - colorStart.a) * age);
+
+		float x0 = px[i] - ox, y0 = py[i] - oy;
+		float u0 = rec.x / (float)tw, v0 = rec.y / (float)th;
+		float u1 = (rec.x + rec.w) / (float)tw, v1 = (rec.y + rec.h) / (float)th;
+
+		v[0].position.x = x0; v[0].position.y = y0; v[0].tex_coord.x = u0; v[0].tex_coord.y = v0; v[0].color = c;
+		v[1].position.x = x0 + w; v[1].position.y = y0; v[1].tex_coord.x = u1; v[1].tex_coord.y = v0; v[1].color = c;
+		v[2].position.x = x0 + w; v[2].position.y = y0 + h; v[2].tex_coord.x = u1; v[2].tex_coord.y = v1; v[2].color = c;
+		v[3].position.x = x0; v[3].position.y = y0 + h; v[3].tex_coord.x = u0; v[3].tex_coord.y = v1; v[3].color = c;
+		v += 4;
+	};
+
+	xyBatchVerts(tex, &verts[0], live, 0, 0);
+};
+
+//Called once per frame
+void xyUpdateEmitters(){
+	for(Uint32 i = 1; i < vcEmitters.slots(); i++){
+		xyEmitter* e = vcEmitters[vcEmitters.handleAt(i)];
+		if(e != 0) e->update();
+	};
+};
@@ -0,0 +1,61 @@
+/*================*\
+| PARTICLES HEADER |
+\*================*/
+
+#ifndef _PARTICLES_H_
+#define _PARTICLES_H_
+
+//Emitters keep their particles as separate arrays
+//of floats instead of an array of structs, so each
+//part of the update is a tight loop over one or two
+//arrays that the compiler can vectorize.
+//
+//Particles are updated once per frame in xyUpdate()
+//and drawn from a range of frames of a sprite, all
+//as one batched draw per emitter.
+
+class xyEmitter{
+private:
+	Uint32 numero;
+	Uint32 sprite;
+
+	//Particle state
+	vector<float> px, py;	//Position
+	vector<float> vx, vy;	//Velocity
+	vector<float> life;		//Frames left to live
+	vector<float> span;		//One over the full lifespan
+	Uint32 live;
+
+	//Settings
+	float x, y;
+	float rate, pending;	//Particles per frame, and the part of one not yet spawned
+	float lifeMin, lifeMax;
+	float speedMin, speedMax, angle, spread;
+	float gx, gy, drag;
+	int frameFirst, frameLast;
+	SDL_Color colorStart, colorEnd;
+	Uint32 limit;
+
+	void spawn(Uint32 count);
+public:
+	xyEmitter(Uint32 _sprite);
+	~xyEmitter();
+	Uint32 getnum();
+	Uint32 getcount();
+	void setPos(float _x, float _y);
+	void setRate(float _rate);
+	void setLife(float _min, float _max);
+	void setSpeed(float _min, float _max, float _angle, float _spread);
+	void setForce(float _gx, float _gy, float _drag);
+	void setFrames(int first, int last);
+	void setColor(Uint32 start, Uint32 end);
+	void setLimit(Uint32 _limit);
+	void burst(Uint32 count);
+	void clear();
+	void update();
+	void draw();
+};
+
+void xyUpdateEmitters();
+
+#endif
@@ -0,0 +1,254 @@
+/*=================*\
+| PRIMITIVES SOURCE |
+\*=================*/
+
+#include "main.h"
+#include "global.h"
+#include "graphics.h"
+#include "batch.h"
+#include "primitives.h"
+
+//Unit circles, indexed by their number of segments
+static vector< vector<SDL_FPoint> > vcCircles;
+static const int maxSegments = 128;
+
+//Scratch buffers so shapes don't allocate every call
+static vector<SDL_FPoint> pPoints;
+static vector<int> pIndices;
+
+static SDL_Color xyShapeColor(){
+	SDL_Color color = {xyGetRed(gvDrawColor), xyGetGreen(gvDrawColor), xyGetBlue(gvDrawColor), xyGetAlpha(gvDrawColor)};
+	return color;
+};
+
+//Bigger circles get more segments so
+//their edges stay smooth
+static int xyCircleSegments(float r){
+	int n = ceil(r * 0.75) * 4;
+	if(n < 8) n = 8;
+	if(n > maxSegments) n = maxSegments;
+	return n;
+};
+
+static const vector<SDL_FPoint>& xyUnitCircle(int n){
+	if(vcCircles.size() <= n) vcCircles.resize(n + 1);
+
+	vector<SDL_FPoint>& circle = vcCircles[n];
+	if(circle.size() == 0){
+		circle.resize(n);
+		for(int i = 0; i < n; i++){
+			double a = (2.0 * pi * i) / n;
+			circle[i].x = cos(a);
+			circle[i].y = sin(a);
+		};
+	};
+
+	return circle;
+};
+
+static void xyPushQuad(float x0, float y0, float x1, float y1, float x2, float y2, float x3, float y3){
+	int first = pPoints.size();
+	SDL_FPoint p;
+
+	p.x = x0; p.y = y0; pPoints.push_back(p);
+	p.x = x1; p.y = y1; pPoints.push_back(p);
+	p.x = x2; p.y = y2; pPoints.push_back(p);
+	p.x = x3; p.y = y3; pPoints.push_back(p);
+
+	pIndices.push_back(first);
+	pIndices.push_back(first + 1);
+	pIndices.push_back(first + 2);
+	pIndices.push_back(first + 2);
+	pIndices.push_back(first + 3);
+	pIndices.push_back(first);
+};
+
+static void xyPushRect(float x, float y, float w, float h){
+	xyPushQuad(x, y, x + w, y, x + w, y + h, x, y + h);
+};
+
+//A segment as a quad w pixels wide, with square
+//ends so joints in a polyline don't leave gaps
+static void xyPushSegment(float x1, float y1, float x2, float y2, float w){
+	float dx = x2 - x1, dy = y2 - y1;
+	float len = sqrt((dx * dx) + (dy * dy));
+
+	//Treat a line with no length as a dot
+	if(len == 0){
+		xyPushRect(x1 - (w / 2), y1 - (w / 2), w, w);
+		return;
+	};
+
+	float ux = (dx / len) * (w / 2), uy = (dy / len) * (w / 2);
+
+	//Lines run through pixel centers
+	x1 += 0.5 - ux; y1 += 0.5 - uy;
+	x2 += 0.5 + ux; y2 += 0.5 + uy;
+
+	xyPushQuad(x1 + uy, y1 - ux, x2 + uy, y2 - ux, x2 - uy, y2 + ux, x1 - uy, y1 + ux);
+};
+
+static void xyShapeSubmit(){
+	if(pIndices.size() > 0) xyBatchShape(&pPoints[0], pPoints.size(), &pIndices[0], pIndices.size(), xyShapeColor());
+	pPoints.clear();
+	pIndices.clear();
+};
+
+void xyDrawPoint(float x, float y){
+	xyPushRect(x, y, 1, 1);
+	xyShapeSubmit();
+};
+
+//Like SDL2_gfx, the far edges are included
+void xyDrawRect(float x, float y, float w, float h, bool fill){
+	if(fill) xyPushRect(x, y, w + 1, h + 1);
+	else {
+		xyPushRect(x, y, w + 1, 1);
+		xyPushRect(x, y + h, w + 1, 1);
+		if(h > 1){
+			xyPushRect(x, y + 1, 1, h - 1);
+			xyPushRect(x + w, y + 1, 1, h - 1);
+		};
+	};
+
+	xyShapeSubmit();
+};
+
+void xyDrawCircle(float x, float y, float r, bool fill){
+	if(r < 0) return;
+
+	int n = xyCircleSegments(r);
+	const vector<SDL_FPoint>& unit = xyUnitCircle(n);
+	x += 0.5;
+	y += 0.5;
+
+	SDL_FPoint p;
+	if(fill){
+		//Fan out from the center
+		r += 0.5;
+		p.x = x;
+		p.y = y;
+		pPoints.push_back(p);
+		for(int i = 0; i < n; i++){
+			p.x = x + (unit[i].x * r);
+			p.y = y + (unit[i].y * r);
+			pPoints.push_back(p);
+
+			pIndices.push_back(0);
+			pIndices.push_back(i + 1);
+			pIndices.push_back(((i + 1) % n) + 1);
+		};
+	} else {
+		//A ring one pixel thick
+		float r0 = (r > 0.5 ? r - 0.5 : 0), r1 = r + 0.5;
+		for(int i = 0; i < n; i++){
+			p.x = x + (unit[i].x * r0);
+			p.y = y + (unit[i].y * r0);
+			pPoints.push_back(p);
+			p.x = x + (unit[i].x * r1);
+			p.y = y + (unit[i].y * r1);
+			pPoints.push_back(p);
+
+			int a = i * 2, b = ((i + 1) % n) * 2;
+			pIndices.push_back(a);
+			pIndices.push_back(a + 1);
+			pIndices.push_back(b + 1);
+			pIndices.push_back(b + 1);
+			pIndices.push_back(b);
+			pIndices.push_back(a);
+		};
+	};
+
+	xyShapeSubmit();
+};
+
+void xyDrawLine(float x1, float y1, float x2, float y2, float w){
+	if(w < 1) w = 1;
+	xyPushSegment(x1, y1, x2, y2, w);
+	xyShapeSubmit();
+};
+
+void xyDrawPolyline(const vector<SDL_FPoint>& pts, float w, bool closed){
+	if(pts.size() == 0) return;
+	if(w < 1) w = 1;
+
+	for(int i = 0; i + 1 < pts.size(); i++){
+		xyPushSegment(pts[i].x, pts[i].y, pts[i + 1].x, pts[i + 1].y, w);
+	};
+	if(closed && pts.size() > 2) xyPushSegment(pts.back().x, pts.back().y, pts[0].x, pts[0].y, w);
+
+	xyShapeSubmit();
+};
+
+//Twice the signed area of a triangle, positive if clockwise on screen
+static float xyCross(const SDL_FPoint& a, const SDL_FPoint& b, const SDL_FPoint& c){
+	return ((b.x - a.x) * (c.y - a.y)) - ((b.y - a.y) * (c.x - a.x));
+};
+
+static bool xyInTriangle(const SDL_FPoint& p, const SDL_FPoint& a, const SDL_FPoint& b, const SDL_FPoint& c){
+	return xyCross(a, b, p) >= 0 && xyCross(b, c, p) >= 0 && xyCross(c, a, p) >= 0;
+};
+
+//Fill a simple polygon by clipping ears off of it.
+//Concave shapes work too, as long as the edges
+//don't cross each other.
+void xyDrawPolygon(const vector<SDL_FPoint>& pts){
+	int n = pts.size();
+	if(n < 3) return;
+
+	//Work in clockwise order
+	float area = 0;
+	for(int i = 0; i < n; i++){
+		const SDL_FPoint& a = pts[i];
+		const SDL_FPoint& b = pts[(i + 1) % n];
+		area += (a.x * b.y) - (b.x * a.y);
+	};
+
+	vector<int> left(n);
+	for(int i = 0; i < n; i++) left[i] = (area >= 0 ? i : n - 1 - i);
+
+	for(int i = 0; i < n; i++){
+		SDL_FPoint p = pts[i];
+		p.x += 0.5;
+		p.y += 0.5;
+		pPoints.push_back(p);
+	};
+
+	int guard = 0;
+	for(int i = 0; left.size() > 3 && guard < left.size();){
+		int m = left.size();
+		int ia = left[(i + m - 1) % m], ib = left[i % m], ic = left[(i + 1) % m];
+		const SDL_FPoint& a = pts[ia];
+		const SDL_FPoint& b = pts[ib];
+		const SDL_FPoint& c = pts[ic];
+
+		//An ear is convex and has no other corner inside it
+		bool ear = xyCross(a, b, c) > 0;
+		for(int j = 0; ear && j < m; j++){
+			int k = left[j];
+			if(k == ia || k == ib || k == ic) continue;
+			if(xyInTriangle(pts[k], a, b, c)) ear = false;
+		};
+
+		if(ear){
+			pIndices.push_back(ia);
+			pIndices.push_back(ib);
+			pIndices.push_back(ic);
+			left.erase(left.begin() + (i % m));
+			guard = 0;
+		} else {
+			i = (i + 1) % m;
+			guard++;
+		};
+	};
+
+	//Whatever is left, including any part that
+	//couldn't be clipped cleanly, is filled as a fan
+	for(int i = 1; i + 1 < left.size(); i++){
+		pIndices.push_back(left[0]);
+		pIndices.push_back(left[i]);
+		pIndices.push_back(left[i + 1]);
+	};
+
+	xyShapeSubmit();
+};
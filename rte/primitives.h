@@ -0,0 +1,22 @@
+/*=================*\
+| PRIMITIVES HEADER |
+\*=================*/
+
+#ifndef _PRIMITIVES_H_
+#define _PRIMITIVES_H_
+
+#include "main.h"
+
+//Shapes are turned into triangles here and
+//queued in the batch with the draw color,
+//so hundreds of them can go out together
+//instead of being drawn pixel by pixel.
+
+void xyDrawPoint(float x, float y);
+void xyDrawRect(float x, float y, float w, float h, bool fill);
+void xyDrawCircle(float x, float y, float r, bool fill);
+void xyDrawLine(float x1, float y1, float x2, float y2, float w);
+void xyDrawPolyline(const vector<SDL_FPoint>& pts, float w, bool closed);
+void xyDrawPolygon(const vector<SDL_FPoint>& pts);
+
+#endif
@@ -0,0 +1,163 @@
+/*===============*\
+| REGISTRY HEADER |
+\*===============*/
+
+#ifndef _REGISTRY_H_
+#define _REGISTRY_H_
+
+#include "main.h"
+#include <unordered_map>
+
+//Handle registry
+//
+//Textures, sprites, fonts, sounds and music are
+//given to scripts as handles. The low bits of a
+//handle are the slot the item is kept in and the
+//high bits are the slot's generation, which goes
+//up every time the slot is freed. A handle kept
+//after its item was deleted no longer matches
+//and finds nothing, instead of finding whatever
+//was put in the slot next.
+//
+//Freed slots are kept in a list, so adding,
+//removing and looking up are all constant time.
+//Slot 0 is never used, so handle 0 means none.
+//
+//The first item in a slot gets a handle equal to
+//the slot, so handles stay small until slots are
+//reused. Generations are 11 bits so handles fit in
+//a positive 32-bit integer, and they wrap around
+//after a slot has been reused 2048 times.
+
+const Uint32 _REG_INDEX_BITS = 20;
+const Uint32 _REG_INDEX_MASK = (1 << _REG_INDEX_BITS) - 1;
+const Uint32 _REG_GEN_MASK = 0x7FF;
+
+inline Uint32 xyHandleIndex(Uint32 handle){
+	return handle & _REG_INDEX_MASK;
+};
+
+inline Uint32 xyHandleGen(Uint32 handle){
+	return (handle >> _REG_INDEX_BITS) & _REG_GEN_MASK;
+};
+
+template <class T>
+class xyRegistry{
+private:
+	vector<T> items;
+	vector<Uint32> gens;
+	vector<Uint32> spare;	//Freed slots, reused last in first out
+	vector<string> keys;	//Name of each slot, if it has one
+	unordered_multimap<string, Uint32> names;
+public:
+	xyRegistry(){
+		clear();
+	};
+
+	//Put an item in a free slot and return its handle.
+	//Nothing is stored for a null item, like a failed load.
+	Uint32 add(T item){
+		if(item == 0) return 0;
+
+		Uint32 index;
+		if(spare.size() > 0){
+			index = spare.back();
+			spare.pop_back();
+		} else {
+			if(items.size() > _REG_INDEX_MASK) return 0;
+			index = items.size();
+			items.push_back(0);
+			gens.push_back(0);
+			keys.push_back("");
+		};
+
+		items[index] = item;
+		return index | (gens[index] << _REG_INDEX_BITS);
+	};
+
+	//Free the slot. The item itself is left to the caller.
+	bool remove(Uint32 handle){
+		if(!valid(handle)) return false;
+
+		Uint32 index = xyHandleIndex(handle);
+		unname(handle);
+		items[index] = 0;
+		gens[index] = (gens[index] + 1) & _REG_GEN_MASK;
+		spare.push_back(index);
+		return true;
+	};
+
+	bool valid(Uint32 handle) const {
+		Uint32 index = xyHandleIndex(handle);
+		if(index == 0 || index >= items.size()) return false;
+		if(gens[index] != xyHandleGen(handle)) return false;
+		return items[index] != 0;
+	};
+
+	//The item, or 0 for a stale or unknown handle
+	T get(Uint32 handle) const {
+		if(!valid(handle)) return 0;
+		return items[xyHandleIndex(handle)];
+	};
+
+	T operator[](Uint32 handle) const {
+		return get(handle);
+	};
+
+	//Swap what a live handle points to
+	bool set(Uint32 handle, T item){
+		if(!valid(handle) || item == 0) return false;
+		items[xyHandleIndex(handle)] = item;
+		return true;
+	};
+
+	//For going through every slot, like when cleaning up
+	Uint32 slots() const {
+		return items.size();
+	};
+
+	Uint32 handleAt(Uint32 index) const {
+		if(index >= items.size()) return 0;
+		return index | (gens[index] << _REG_INDEX_BITS);
+	};
+
+	//Name lookups. Several items can share a name.
+	void name(Uint32 handle, const string& key){
+		if(!valid(handle)) return;
+		unname(handle);
+		keys[xyHandleIndex(handle)] = key;
+		names.insert(make_pair(key, handle));
+	};
+
+	Uint32 find(const string& key) const {
+		typename unordered_multimap<string, Uint32>::const_iterator it = names.find(key);
+		if(it == names.end()) return 0;
+		return it->second;
+	};
+
+	void unname(Uint32 handle){
+		if(!valid(handle)) return;
+		string& key = keys[xyHandleIndex(handle)];
+		if(key == "") return;
+
+		typedef typename unordered_multimap<string, Uint32>::iterator nameIt;
+		pair<nameIt, nameIt> range = names.equal_range(key);
+		for(nameIt it = range.first; it != range.second; ++it){
+			if(it->second == handle){
+				names.erase(it);
+				break;
+			};
+		};
+		key.clear();
+	};
+
+	void clear(){
+		items.assign(1, 0);
+		gens.assign(1, 0);
+		keys.assign(1, "");
+		spare.clear();
+		names.clear();
+	};
+};
+
+#endif
@@ -0,0 +1,150 @@
+/*==================*\
+| RENDERSTATE SOURCE |
+\*==================*/
+
+#include "main.h"
+#include "global.h"
+#include "renderstate.h"
+#include <map>
+
+//What SDL was last told for one texture
+struct xyTexState{
+	SDL_BlendMode blend;
+};
+
+//What SDL was last told. Nothing is assumed
+//until the first call or after a reset.
+static bool sColorSet = 0;
+static Uint8 sR = 0, sG = 0, sB = 0, sA = 0;
+static bool sBlendSet = 0;
+static SDL_BlendMode sBlend = SDL_BLENDMODE_NONE;
+static bool sTargetSet = 0;
+static SDL_Texture* sTarget = 0;
+static map<SDL_Texture*, xyTexState> sTextures;
+
+//Counters for this frame and the last finished one
+static xyStateStats sStats = {0, 0};
+static xyStateStats sLast = {0, 0};
+
+//Custom blend modes some renderers can't do
+static bool sWarned = 0;
+
+//Returns true if the call has to go through
+static bool xyStateCount(bool same){
+	if(same) sStats.skipped++;
+	else sStats.calls++;
+	return !same;
+};
+
+//Only RenderClear() reads the draw color, since
+//shapes carry their color in their vertices
+void xyStateColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a){
+	if(!xyStateCount(sColorSet && r == sR && g == sG && b == sB && a == sA)) return;
+
+	SDL_SetRenderDrawColor(gvRender, r, g, b, a);
+	sColorSet = 1;
+	sR = r;
+	sG = g;
+	sB = b;
+	sA = a;
+};
+
+//Fill the current target with a color
+void xyStateClear(Uint8 r, Uint8 g, Uint8 b, Uint8 a){
+	xyStateColor(r, g, b, a);
+	SDL_RenderClear(gvRender);
+};
+
+//Blend mode for untextured geometry
+void xyStateBlend(SDL_BlendMode mode){
+	if(!xyStateCount(sBlendSet && mode == sBlend)) return;
+
+	SDL_SetRenderDrawBlendMode(gvRender, mode);
+	sBlendSet = 1;
+	sBlend = mode;
+};
+
+void xyStateTarget(SDL_Texture* tex){
+	if(!xyStateCount(sTargetSet && tex == sTarget)) return;
+
+	SDL_SetRenderTarget(gvRender, tex);
+	sTargetSet = 1;
+	sTarget = tex;
+};
+
+SDL_Texture* xyStateGetTarget(){
+	if(!sTargetSet) return SDL_GetRenderTarget(gvRender);
+	return sTarget;
+};
+
+//Textures start out unknown, so the first
+//call for each one always goes through
+static xyTexState& xyStateTexture(SDL_Texture* tex, bool* known){
+	map<SDL_Texture*, xyTexState>::iterator it = sTextures.find(tex);
+	*known = (it != sTextures.end());
+	if(*known) return it->second;
+
+	xyTexState& ts = sTextures[tex];
+	ts.blend = SDL_BLENDMODE_INVALID;
+	return ts;
+};
+
+void xyStateTextureBlend(SDL_Texture* tex, SDL_BlendMode mode){
+	if(tex == 0) return;
+
+	bool known;
+	xyTexState& ts = xyStateTexture(tex, &known);
+	if(!xyStateCount(known && ts.blend == mode)) return;
+
+	if(SDL_SetTextureBlendMode(tex, mode) != 0){
+		//Fall back to normal blending rather than
+		//keeping whatever mode the texture had
+		if(!sWarned) xyPrint(0, "Blend mode not supported by this renderer! SDL Error: %s\n", SDL_GetError());
+		sWarned = 1;
+		SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+	};
+	ts.blend = mode;
+};
+
+//A texture is about to be destroyed. Its address
+//may be handed to a new texture afterwards.
+void xyStateForget(SDL_Texture* tex){
+	sTextures.erase(tex);
+	if(sTargetSet && tex == sTarget) sTargetSet = 0;
+};
+
+//Stop trusting the cache, like after
+//the renderer has lost its device
+void xyStateReset(){
+	sColorSet = 0;
+	sBlendSet = 0;
+	sTargetSet = 0;
+	sTextures.clear();
+};
+
+//Turn one of the bm_* constants into a blend mode
+SDL_BlendMode xyStateBlendMode(int bm){
+	switch(bm){
+		case 1:
+			return SDL_BLENDMODE_ADD;
+		case 2:
+			//Take the source away from what is already there
+			return SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_SRC_ALPHA, SDL_BLENDFACTOR_ONE, SDL_BLENDOPERATION_REV_SUBTRACT, SDL_BLENDFACTOR_ZERO, SDL_BLENDFACTOR_ONE, SDL_BLENDOPERATION_ADD);
+		case 3:
+			return SDL_BLENDMODE_MUL;
+		default:
+			return SDL_BLENDMODE_BLEND;
+	};
+};
+
+//Called once per frame after presenting
+void xyStateEndFrame(){
+	sLast = sStats;
+	sStats.calls = 0;
+	sStats.skipped = 0;
+};
+
+//Counters from the last finished frame
+const xyStateStats& xyGetStateStats(){
+	return sLast;
+};
@@ -0,0 +1,40 @@
+/*==================*\
+| RENDERSTATE HEADER |
+\*==================*/
+
+#ifndef _RENDERSTATE_H_
+#define _RENDERSTATE_H_
+
+#include "main.h"
+
+//Renderer state cache
+//
+//SDL doesn't check whether a setting is
+//already what it is being changed to, and
+//some backends flush their own queue on every
+//state change. Everything that touches the
+//draw color, blend modes or the render target
+//goes through here, so calls that would change
+//nothing are skipped.
+//
+//The cache can only be trusted as long as
+//nothing calls SDL directly behind its back.
+
+struct xyStateStats{
+	Uint32 calls;	//State changes passed on to SDL
+	Uint32 skipped;	//State changes that were already current
+};
+
+void xyStateColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void xyStateClear(Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void xyStateBlend(SDL_BlendMode mode);
+void xyStateTarget(SDL_Texture* tex);
+SDL_Texture* xyStateGetTarget();
+void xyStateTextureBlend(SDL_Texture* tex, SDL_BlendMode mode);
+void xyStateForget(SDL_Texture* tex);
+void xyStateReset();
+SDL_BlendMode xyStateBlendMode(int bm);
+void xyStateEndFrame();
+const xyStateStats& xyGetStateStats();
+
+#endif
@@ -9,8 +9,26 @@
 #include "graphics.h"
 #include "sprite.h"
 #include "maths.h"
+#include "batch.h"
+#include "atlas.h"
+#include "cache.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define _XY_SSE2_
+#endif
+
+//Names are kept with the slash in front, but
+//are looked up with or without it
+static string xySpriteKey(const string& name){
+	if(name.size() > 0 && name[0] == '/') return name.substr(1);
+	return name;
+};
 
-xySprite::xySprite(const char* filename, Uint32 width, Uint32 height, Uint32 margin, Uint32 padding, int pivotX, int pivotY, Uint32 _frames){
+//A sheet that was already decoded, like by the
+//loader threads, can be given instead of being
+//read from the file. The sprite frees it.
+xySprite::xySprite(const char* filename, Uint32 width, Uint32 height, Uint32 margin, Uint32 padding, int pivotX, int pivotY, Uint32 _frames, SDL_Surface* sheet){
 	//Set variables
 	w = width;
 	h = height;
@@ -20,46 +38,16 @@ xySprite::xySprite(const char* filename, Uint32 width, Uint32 height, Uint32 mar
 	pvY = pivotY;
 	numero = 0;
 	frames = _frames;
-	tex = xyLoadImage(filename);
+	loadSheet(filename, sheet);
 	name = filename;
-	//SDL_QueryTexture(vcTextures[tex], format, 0, 0, 0); //// DO NOT USE! ////
 
 	//Extract short file name
 	string::size_type slashnum = name.find_last_of("/");
 	if(slashnum != string::npos) name = name.substr(slashnum, name.length() - 1);
 
 	//Add sprite to list
-
-	if(vcSprites.size() == 0){
-		vcSprites.push_back(this);
-		numero = 0;
-	} else {
-		//Check for an open space in the list
-		for(int i = 1; i < vcSprites.size(); i++){
-			if(vcSprites[i] == 0){
-				vcSprites[i] = this;
-				numero = i;
-				break;
-			};
-		};
-
-		//If an open space wasn't found
-		if(numero == 0){
-			vcSprites.push_back(this);
-			numero = vcSprites.size() - 1;
-		};
-	};
-
-	//Parse the image for rows and colums
-	int origW, origH;
-	SDL_QueryTexture(vcTextures[tex], 0, 0, &origW, &origH);
-	origW -= mar;
-	origH -= mar;
-	col = floor((float)(origW / (w + pad)));
-	row = floor((float)(origH / (h + pad)));
-	if(col < 1) col = 1;
-	if(row < 1) row = 1;
-	if(frames == 0) frames = col * row;
+	numero = vcSprites.add(this);
+	vcSprites.name(numero, xySpriteKey(name));
 };
 
 void xySprite::replaceSprite(const char* filename, Uint32 width, Uint32 height, Uint32 margin, Uint32 padding, int pivotX, int pivotY, Uint32 _frames){
@@ -70,24 +58,82 @@ void xySprite::replaceSprite(const char* filename, Uint32 width, Uint32 height,
 	pad = padding;
 	pvX = pivotX;
 	pvY = pivotY;
-	numero = 0;
 	frames = _frames;
-	Uint32 newtex = xyLoadImage(filename);
 	name = filename;
-	//SDL_QueryTexture(vcTextures[tex], format, 0, 0, 0); //// DO NOT USE! ////
+
+	//Others sharing this sprite still want the old one
+	xyCacheForget(_LK_SPRITE, numero);
 
 	//Delete old texture
-	xyDeleteImage(tex);
-	tex = newtex;
+	freeSheet();
+	loadSheet(filename, 0);
 
 	//Extract short file name
 	name = filename;
 	string::size_type slashnum = name.find_last_of("/");
 	if(slashnum != string::npos) name = name.substr(slashnum, name.length() - 1);
+	vcSprites.name(numero, xySpriteKey(name));
+};
+
+xySprite::~xySprite(){
+	//Give back the atlas space, or the sheet's own texture
+	freeSheet();
+
+	//Remove from list
+	vcSprites.remove(numero);
+};
+
+//Make a sprite, or share one already cut from
+//the same file the same way. Returns its handle.
+Uint32 xyNewSprite(const char* filename, Uint32 width, Uint32 height, Uint32 margin, Uint32 padding, int pivotX, int pivotY, Uint32 _frames){
+	string key = xyCacheKey(filename, width, height, margin, padding, pivotX, pivotY, _frames);
+	Uint32 hit = xyCacheGet(_LK_SPRITE, key);
+	if(hit != 0) return hit;
+
+	xySprite* newSprite = new xySprite(filename, width, height, margin, padding, pivotX, pivotY, _frames);
+	xyCachePut(_LK_SPRITE, key, newSprite->getnum());
+	return newSprite->getnum();
+};
+
+//Delete a sprite once nothing else is using it
+void xyDeleteSprite(Uint32 spr){
+	if(vcSprites[spr] == 0) return;
+	if(!xyCacheDrop(_LK_SPRITE, spr)) return;
+	delete vcSprites[spr];
+};
+
+//A sprite made from a file with this name, or 0
+Uint32 xyFindSprite(const string& name){
+	return vcSprites.find(xySpriteKey(name));
+};
+
+//Load the sheet into an atlas page if it fits,
+//otherwise give it a texture of its own
+void xySprite::loadSheet(const char* filename, SDL_Surface* sheet){
+	packed = 0;
+	osX = 0;
+	osY = 0;
+	ink.clear();
+
+	int origW = 0, origH = 0;
+	if(sheet == 0) sheet = xyLoadSurface(filename);
+	if(sheet == 0){
+		xyPrint(0, "Unable to load file: %s", filename);
+		gvQuit = 1;
+		tex = xyAddTexture(0);
+	} else {
+		origW = sheet->w;
+		origH = sheet->h;
+
+		if(xyAtlasPack(sheet, &tex, &osX, &osY)) packed = 1;
+		else {
+			SDL_Texture* ntex = SDL_CreateTextureFromSurface(gvRender, sheet);
+			if(ntex == 0) xyPrint(0, "Unable to create texture from %s! SDL Error: %s\n", filename, SDL_GetError());
+			tex = xyAddTexture(ntex);
+		};
+	};
 
 	//Parse the image for rows and colums
-	int origW, origH;
-	SDL_QueryTexture(vcTextures[tex], 0, 0, &origW, &origH);
 	origW -= mar;
 	origH -= mar;
 	col = floor((float)(origW / (w + pad)));
@@ -95,63 +141,145 @@ void xySprite::replaceSprite(const char* filename, Uint32 width, Uint32 height,
 	if(col < 1) col = 1;
 	if(row < 1) row = 1;
 	if(frames == 0) frames = col * row;
+
+	//Measure the frames while the pixels are still around
+	if(sheet != 0){
+		scanInk(sheet);
+		SDL_FreeSurface(sheet);
+	};
 };
 
-xySprite::~xySprite(){
-	//Remove from list
-	if(numero == vcSprites.size() - 1) vcSprites.pop_back();
-	else vcSprites[numero] = 0;
+//Find the highest alpha in every pixel column of every
+//frame. Fonts use this to get the width of each glyph
+//without reading anything back from the GPU.
+//
+//Taking the max of whole pixels byte by byte gives the
+//max of each channel separately, so the alpha ends up
+//in the top byte no matter what the colors were. That
+//lets a whole band of rows be folded together 16 bytes
+//at a time before the columns are split into frames.
+void xySprite::scanInk(SDL_Surface* sheet){
+	ink.assign(frames * w, 0);
+	if(w == 0 || h == 0) return;
+
+	vector<Uint32> acc(sheet->w + 4);
+
+	SDL_LockSurface(sheet);
+	const Uint8* pixels = (const Uint8*)sheet->pixels;
+
+	for(Uint32 fy = 0; fy < row; fy++){
+		int top = mar + (fy * (h + pad));
+		int bottom = top + h;
+		if(top >= sheet->h) break;
+		if(bottom > sheet->h) bottom = sheet->h;
+
+		//Fold this band of rows into one
+		fill(acc.begin(), acc.end(), 0);
+		for(int y = top; y < bottom; y++){
+			const Uint32* line = (const Uint32*)(pixels + (y * sheet->pitch));
+			int x = 0;
+#ifdef _XY_SSE2_
+			for(; x + 4 <= sheet->w; x += 4){
+				__m128i a = _mm_loadu_si128((const __m128i*)&acc[x]);
+				__m128i p = _mm_loadu_si128((const __m128i*)&line[x]);
+				_mm_storeu_si128((__m128i*)&acc[x], _mm_max_epu8(a, p));
+			};
+#endif
+			for(; x < sheet->w; x++){
+				Uint32 a = acc[x], p = line[x];
+				if((p >> 24) > (a >> 24)) acc[x] = p;
+			};
+		};
+
+		//Split the band into frames
+		for(Uint32 fx = 0; fx < col; fx++){
+			Uint32 f = (fy * col) + fx;
+			if(f >= frames) break;
+
+			int left = mar + (fx * (w + pad));
+			for(Uint32 i = 0; i < w && left + i < sheet->w; i++){
+				ink[(f * w) + i] = acc[left + i] >> 24;
+			};
+		};
+	};
+
+	SDL_UnlockSurface(sheet);
 };
 
-void xySprite::draw(int f, int x, int y){
+//Columns of a frame with alpha above the threshold.
+//Frames with nothing in them come back as full width.
+void xySprite::getInk(int f, Uint8 threshold, int* x, int* iw){
+	*x = 0;
+	*iw = w;
+
+	if(ink.size() < frames * w) return;
+	const Uint8* c = &ink[xyWrap(f, 0, frames - 1) * w];
+
+	int first = -1, last = -1;
+	for(int i = 0; i < w; i++){
+		if(c[i] > threshold){
+			if(first == -1) first = i;
+			last = i;
+		};
+	};
+
+	if(first == -1) return;
+	*x = first;
+	*iw = last - first + 1;
+};
+
+void xySprite::freeSheet(){
+	if(packed) xyAtlasRelease(tex);
+	else xyDeleteImage(tex);
+	packed = 0;
+};
+
+//Get where a frame is in the sprite's texture
+void xySprite::getFrame(int f, SDL_Rect* rec){
 	int fd = xyWrap(f, 0, frames - 1);
 
+    int fx = fd % col;
+    int fy = (fd - fx) / col;
+
+    rec->x = osX + mar + (fx * w) + (pad * fx);
+    rec->y = osY + mar + (fy * h) + (pad * fy);
+    rec->w = w;
+    rec->h = h;
+};
+
+void xySprite::draw(int f, int x, int y){
     SDL_Rect rec;
-    SDL_Rect des;
+    SDL_FRect des;
 
     des.x = x - pvX;
     des.y = y - pvY;
     des.w = w;
     des.h = h;
 
-    int fx = fd % col;
-    int fy = (fd - fx) / col;
+    getFrame(f, &rec);
 
-    rec.x = mar + (fx * w) + (pad * fx);
-    rec.y = mar + (fy * h) + (pad * fy);
-    rec.w = w;
-    rec.h = h;
-
-    SDL_RenderCopy(gvRender, vcTextures[tex], &rec, &des);
+    xyBatchQuad(vcTextures[tex], &rec, &des);
 };
 
-void xySprite::drawex(int f, int x, int y, int angle, SDL_RendererFlip flip, float xscale, float yscale){
+void xySprite::drawex(int f, int x, int y, int angle, SDL_RendererFlip flip, float xscale, float yscale, Uint8 alpha){
 	//Do nothing if scaling is set to 0 on either dimension
 	if(xscale == 0 || yscale == 0) return;
 
-	int fd = xyWrap(f, 0, frames - 1);
-
     SDL_Rect rec;
-    SDL_Rect des;
+    SDL_FRect des;
 
     des.x = x - (pvX * xscale);
     des.y = y - (pvY * yscale);
     des.w = w * xscale;
     des.h = h * yscale;
 
-    int fx = fd % col;
-    int fy = (fd - fx) / col;
-
-    rec.x = mar + (fx * w) + (pad * fx);
-    rec.y = mar + (fy * h) + (pad * fy);
-    rec.w = w;
-    rec.h = h;
+    getFrame(f, &rec);
 
-    SDL_Point *piv = new SDL_Point;
-    piv->x = pvX * xscale;
-    piv->y = pvY * yscale;
+    SDL_FPoint piv;
+    piv.x = pvX * xscale;
+    piv.y = pvY * yscale;
 
-    SDL_RenderCopyEx(gvRender, vcTextures[tex], &rec, &des, (double)angle, piv, flip);
+    xyBatchQuadEx(vcTextures[tex], &rec, &des, (double)angle, &piv, flip, alpha);
 };
 
 Uint32 xySprite::getnum(){
@@ -168,3 +296,5 @@ Uint32 xySprite::getframes(){
 
 Uint32 xySprite::getw(){ return w; };
 Uint32 xySprite::geth(){ return h; };
+float xySprite::getpvx(){ return pvX; };
+float xySprite::getpvy(){ return pvY; };
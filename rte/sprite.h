@@ -9,21 +9,34 @@ class xySprite{
 private:
 	Uint32 numero, mar, pad, w, h, tex, col, row, frames;
 	bool didLoad;
-	int osX, osY;
+	bool packed; //Sheet lives in an atlas page
+	int osX, osY; //Where the sheet starts in its texture
 	float pvX, pvY;
 	Uint32 *format;
+	vector<Uint8> ink; //Highest alpha of each pixel column, frame by frame
+	void loadSheet(const char* filename, SDL_Surface* sheet);
+	void scanInk(SDL_Surface* sheet);
+	void freeSheet();
 public:
 	string name;
-	xySprite(const char* filename, Uint32 width, Uint32 height, Uint32 margin, Uint32 padding, int pivotX, int pivotY, Uint32 _frames);
+	xySprite(const char* filename, Uint32 width, Uint32 height, Uint32 margin, Uint32 padding, int pivotX, int pivotY, Uint32 _frames, SDL_Surface* sheet = 0);
 	~xySprite();
 	void replaceSprite(const char* filename, Uint32 width, Uint32 height, Uint32 margin, Uint32 padding, int pivotX, int pivotY, Uint32 _frames);
 	void draw(int f, int x, int y);
-	void drawex(int f, int x, int y, int angle, SDL_RendererFlip flip, float xscale, float yscale);
+	void drawex(int f, int x, int y, int angle, SDL_RendererFlip flip, float xscale, float yscale, Uint8 alpha = 0xFF);
+	void getFrame(int f, SDL_Rect* rec);
+	void getInk(int f, Uint8 threshold, int* x, int* iw);
 	Uint32 getnum();
 	Uint32 gettex();
 	Uint32 getframes();
 	Uint32 getw();
 	Uint32 geth();
+	float getpvx();
+	float getpvy();
 };
 
+Uint32 xyNewSprite(const char* filename, Uint32 width, Uint32 height, Uint32 margin, Uint32 padding, int pivotX, int pivotY, Uint32 _frames);
+void xyDeleteSprite(Uint32 spr);
+Uint32 xyFindSprite(const string& name);
+
 #endif
@@ -9,6 +9,8 @@
 #include "graphics.h"
 #include "sprite.h"
 #include "text.h"
+#include "batch.h"
+#include "renderstate.h"
 
 //New bitmap font format to replace SDL_ttf.
 //
@@ -19,7 +21,9 @@
 //checking each pixel column for transparency
 //to find the minimum and maximum X
 //coordinates containing pixels with alpha
-//values above the threshold.
+//values above the threshold. The scan is done
+//on the sheet's pixels when the sprite loads,
+//so fonts only have to look up the results.
 //
 //Might be a good idea to bring back SDL_ttf
 //to create bitmap fonts but use the same
@@ -27,11 +31,6 @@
 
 xyFont::xyFont(Uint32 index, Uint32 firstchar, Uint8 threshold, bool monospace, int _kern){
 	//If there is no sprite that can be used, then cancel
-    if(vcSprites.size() <= index){
-		xyPrint(0, "The sprite does not exist!");
-		delete this;
-		return;
-	};
     if(vcSprites[index] == 0){
     	xyPrint(0, "The sprite does not exist!");
 		delete this;
@@ -39,26 +38,7 @@ xyFont::xyFont(Uint32 index, Uint32 firstchar, Uint8 threshold, bool monospace,
     };
 
     //Add to the list
-	numero = -1;
-	if(vcFonts.size() == 0){
-		vcFonts.push_back(this);
-		numero = 0;
-	} else {
-		//Check for an open space in the list
-		for(int i = 1; i < vcFonts.size(); i++){
-			if(vcFonts[i] == 0){
-				vcFonts[i] = this;
-				numero = i;
-				break;
-			};
-		};
-
-		//If an open space wasn't found
-		if(numero == -1){
-			vcFonts.push_back(this);
-			numero = vcFonts.size() - 1;
-		};
-	};
+	numero = vcFonts.add(this);
 
 	//Get the sprite
 	source = vcSprites[index];
@@ -66,72 +46,75 @@ xyFont::xyFont(Uint32 index, Uint32 firstchar, Uint8 threshold, bool monospace,
 	//Get frame number and x/width
 	cx.resize(source->getframes());
 	cw.resize(source->getframes());
-	if(true){//Monospace
-		if(cx.size() > 0){
-			for(int i = 0; i < source->getframes(); i++){
-				cx[i] = 0;
-				cw[i] = source->getw();
-			};
-        };
-	} else {//Dynamic (ignored until character scanning is done)
-        //TODO: Get individual character width
-
-        //Get and store current render target
-        SDL_Texture* ttex;
-        ttex = SDL_GetRenderTarget(gvRender);
-
-        //Make temporary texture
-        SDL_Texture* worktex = SDL_CreateTexture(gvRender, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, source->getw(), source->geth());
-
-        //Set render target to temp
-        SDL_SetRenderTarget(gvRender, worktex);
-
-        //For each frame in the source sprite
-        for(int i = 0; i < source->getframes(); i++){
-			//Render current frame
-			source->draw(i, 0, 0);
-
-			//For each column in source width
-			for(int j = 0; j < source->getw(); j++){
-				bool found = 0;
-
-				//For each pixel in the column
-				for(int k = 0; k < source->geth(); k++){
-					//If pixel alpha is above threshold, set cx here, then break
-				};
-			};
-			//For each column in source width
-			for(int j = 0; j < source->getw(); j++){
-				bool found = 0;
-
-				//For each pixel in the column
-				for(int k = 0; k < source->geth(); k++){
-					//If pixel alpha is above threshold, update cw to this coord minus cx, then break
-				};
-			};
-			//Clear texture
+	for(int i = 0; i < source->getframes(); i++){
+		if(monospace){
+			cx[i] = 0;
+			cw[i] = source->getw();
+		} else {
+			//Columns were measured when the sprite was loaded
+			source->getInk(i, threshold, &cx[i], &cw[i]);
 		};
-        //Delete temp texture
-        //Reset render target to stored texture
 	};
 
+	mono = monospace;
 	start = firstchar;
 	kern = _kern;
 };
 
-void xyFont::draw(int x, int y, string text){
-	int dx = x, dy = y; //Set cursor start position
+//Turn a string into glyph quads starting at 0,0.
+//Returns the texture the quads are mapped to, since
+//the font's sprite may have been packed into an atlas.
+SDL_Texture* xyFont::layout(const string& text, vector<SDL_Vertex>& verts){
+	verts.clear();
+
+	SDL_Texture* gtex = gettexture();
+	if(gtex == 0) return 0;
+
+	//Size is only needed to turn pixels into UVs
+	int tw = 1, th = 1;
+	SDL_QueryTexture(gtex, 0, 0, &tw, &th);
+	if(tw <= 0) tw = 1;
+	if(th <= 0) th = 1;
+
+	float gh = source->geth();
+	float px = source->getpvx();
+	float py = source->getpvy();
+
+	SDL_Color white = {0xFF, 0xFF, 0xFF, 0xFF};
+	SDL_Vertex vert;
+	vert.color = white;
+	SDL_Rect rec;
+
+	int dx = 0, dy = 0; //Set cursor start position
 	int c; //Current character by font index
 
 	//Loop to end of string
 	for(int i = 0; i < text.length(); i++){
 		if (text[i] == '\n'){
 			dy += source->geth();
-			dx = x;
+			dx = 0;
 		} else {
 			c = (int)text[i] - start; //Get current character and apply font offset
 			if (c >= 0 && c < cw.size()){ //Is this character defined in the font?
-				source->draw(c, dx, dy);
+				//Only the columns with ink in them are drawn
+				source->getFrame(c, &rec);
+				rec.x += cx[c];
+				rec.w = cw[c];
+				float gw = cw[c];
+
+				float x0 = dx - px, y0 = dy - py;
+				float u0 = rec.x / (float)tw, v0 = rec.y / (float)th;
+				float u1 = (rec.x + rec.w) / (float)tw, v1 = (rec.y + rec.h) / (float)th;
+
+				vert.position.x = x0; vert.position.y = y0; vert.tex_coord.x = u0; vert.tex_coord.y = v0;
+				verts.push_back(vert);
+				vert.position.x = x0 + gw; vert.tex_coord.x = u1;
+				verts.push_back(vert);
+				vert.position.y = y0 + gh; vert.tex_coord.y = v1;
+				verts.push_back(vert);
+				vert.position.x = x0; vert.tex_coord.x = u0;
+				verts.push_back(vert);
+
 				dx += cw[c] + kern;
 			} else {
 				// undefined characters should be blank
@@ -139,8 +122,176 @@ void xyFont::draw(int x, int y, string text){
 			};
 		};
 	};
+
+	return gtex;
+};
+
+void xyFont::draw(int x, int y, const string& text){
+	//Kept around so it only grows to the longest string
+	static vector<SDL_Vertex> verts;
+
+	SDL_Texture* gtex = layout(text, verts);
+	if(verts.size() == 0) return;
+
+	xyBatchVerts(gtex, &verts[0], verts.size() / 4, x, y);
+};
+
+SDL_Texture* xyFont::gettexture(){
+	return vcTextures[source->gettex()];
 };
 
 Uint32 xyFont::getnum(){
 	return numero;
 };
+
+//////////////////
+// TEXT OBJECTS //
+/////////////////{
+
+xyText::xyText(Uint32 _font, const string& _text){
+	font = _font;
+	text = _text;
+	tex = 0;
+	bake = 0;
+	baked = 0;
+	dirty = 1;
+	bx = by = 0;
+	bw = bh = 0;
+
+	if(vcFonts[font] == 0){
+		xyPrint(0, "The font does not exist!");
+		font = 0;
+	};
+
+	//Add to the list
+	numero = vcTexts.add(this);
+
+	layout();
+};
+
+xyText::~xyText(){
+	freeBaked();
+
+	//Remove from list
+	vcTexts.remove(numero);
+};
+
+Uint32 xyText::getnum(){
+	return numero;
+};
+
+void xyText::layout(){
+	tex = 0;
+	verts.clear();
+	if(vcFonts[font] != 0) tex = vcFonts[font]->layout(text, verts);
+	dirty = 1;
+};
+
+//Only lay the string out again if it actually changed
+void xyText::setText(const string& _text){
+	if(_text == text) return;
+
+	text = _text;
+	layout();
+};
+
+void xyText::setBaked(bool _bake){
+	bake = _bake;
+	if(!bake) freeBaked();
+	dirty = 1;
+};
+
+void xyText::freeBaked(){
+	if(baked == 0) return;
+
+	xyBatchForget(baked);
+	xyStateForget(baked);
+	SDL_DestroyTexture(baked);
+	baked = 0;
+};
+
+//Draw the glyphs into the baked texture
+void xyText::render(){
+	dirty = 0;
+
+	//Find the area covered by the glyphs
+	float x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+	for(int i = 0; i < verts.size(); i++){
+		if(i == 0 || verts[i].position.x < x0) x0 = verts[i].position.x;
+		if(i == 0 || verts[i].position.y < y0) y0 = verts[i].position.y;
+		if(i == 0 || verts[i].position.x > x1) x1 = verts[i].position.x;
+		if(i == 0 || verts[i].position.y > y1) y1 = verts[i].position.y;
+	};
+
+	bx = floor(x0);
+	by = floor(y0);
+	int nw = ceil(x1) - bx;
+	int nh = ceil(y1) - by;
+
+	//Keep the old texture if the text still fits the same size
+	if(baked != 0 && (nw != bw || nh != bh)) freeBaked();
+	bw = nw;
+	bh = nh;
+	if(bw <= 0 || bh <= 0) return;
+
+	if(baked == 0){
+		baked = SDL_CreateTexture(gvRender, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, bw, bh);
+		if(baked == 0){
+			//Drawn from the glyph quads instead
+			xyPrint(0, "Unable to bake text! SDL Error: %s\n", SDL_GetError());
+			return;
+		};
+	};
+
+	//Glyphs are always baked with normal blending, since
+	//adding or multiplying onto a clear texture leaves nothing
+	SDL_BlendMode blend = xyBatchGetBlend();
+	xyPushDrawTarget(baked);
+	xyBatchSetBlend(SDL_BLENDMODE_BLEND);
+
+	//Start from a transparent texture
+	xyStateClear(0, 0, 0, 0);
+
+	xyBatchVerts(tex, &verts[0], verts.size() / 4, -bx, -by);
+	xyPopDrawTarget();
+	xyBatchSetBlend(blend);
+};
+
+void xyText::draw(int x, int y){
+	if(vcFonts[font] == 0) return;
+
+	//The font's sprite moved to another texture
+	if(vcFonts[font]->gettexture() != tex) layout();
+	if(verts.size() == 0) return;
+
+	if(bake){
+		if(dirty) render();
+
+		if(baked != 0){
+			SDL_FRect des;
+			des.x = x + bx;
+			des.y = y + by;
+			des.w = bw;
+			des.h = bh;
+			xyBatchBaked(baked, &des);
+			return;
+		};
+	};
+
+	xyBatchVerts(tex, &verts[0], verts.size() / 4, x, y);
+};
+
+//Baked text has to be drawn again
+//if the render targets were lost
+void xyText::invalidate(){
+	dirty = 1;
+};
+
+void xyTextInvalidate(){
+	for(Uint32 i = 1; i < vcTexts.slots(); i++){
+		xyText* t = vcTexts[vcTexts.handleAt(i)];
+		if(t != 0) t->invalidate();
+	};
+};
+
+//}
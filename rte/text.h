@@ -18,7 +18,40 @@ private:
 public:
 	xyFont(Uint32 index, Uint32 firstchar, Uint8 threshold, bool monospace, int _kern);
 	Uint32 getnum();
-	void draw(int x, int y, string text);
+	SDL_Texture* gettexture();
+	SDL_Texture* layout(const string& text, vector<SDL_Vertex>& verts);
+	void draw(int x, int y, const string& text);
 };
 
+//Text objects keep the glyph quads of a string
+//between frames, so a string that doesn't change
+//is only laid out once. They can also be baked
+//into a texture and drawn as a single quad.
+class xyText{
+private:
+	Uint32 numero;
+	Uint32 font;
+	string text;
+	vector<SDL_Vertex> verts;	//Four per glyph, relative to the text's position
+	SDL_Texture* tex;			//Glyph texture the layout was made for
+	bool bake;
+	SDL_Texture* baked;			//Rendered text, 0 while not baked
+	bool dirty;					//Baked texture needs to be drawn again
+	float bx, by;				//Top left corner of the baked texture
+	int bw, bh;
+	void layout();
+	void render();
+	void freeBaked();
+public:
+	xyText(Uint32 _font, const string& _text);
+	~xyText();
+	Uint32 getnum();
+	void setText(const string& _text);
+	void setBaked(bool _bake);
+	void draw(int x, int y);
+	void invalidate();
+};
+
+void xyTextInvalidate();
+
 #endif
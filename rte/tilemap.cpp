@@ -0,0 +1,538 @@
+/*==============*\
+| TILEMAP SOURCE |
+\*==============*/
+
+#include "main.h"
+#include "global.h"
+#include "graphics.h"
+#include "fileio.h"
+#include "sprite.h"
+#include "batch.h"
+#include "renderstate.h"
+#include "tilemap.h"
+#include "tinyxml2.h"
+
+//Native loader for maps saved by Tiled as JSON.
+//
+//Tile layers are kept as flat GID arrays and
+//each tileset becomes a sprite, so a whole
+//layer can be drawn with one call instead of
+//one call per tile from Squirrel.
+//
+//Object layers are skipped. Scripts can still
+//read them with jsonRead().
+
+Uint32 gvChunkBudget = 32 * 1024 * 1024;
+static vector<xyTileChunk*> vcChunks;	//Chunks holding a texture
+static Uint32 chunkBytes = 0;			//VRAM used by those textures
+
+//Read an integer from a JSON object, or use a default
+static int xyJSONInt(cJSON* obj, const char* key, int def){
+	cJSON* item = cJSON_GetObjectItem(obj, key);
+	if(item == 0 || item->type != cJSON_Number) return def;
+	return (int)item->valuedouble;
+};
+
+static const char* xyJSONString(cJSON* obj, const char* key){
+	cJSON* item = cJSON_GetObjectItem(obj, key);
+	if(item == 0 || item->type != cJSON_String) return 0;
+	return item->valuestring;
+};
+
+//Paths in a map are relative to the map itself
+static string xyTilePath(const string& dir, const char* file){
+	if(file[0] == '/' || file[0] == '\\' || (file[0] != 0 && file[1] == ':')) return file;
+	return dir + file;
+};
+
+xyTilemap::xyTilemap(const char* filename){
+	mapw = 0;
+	maph = 0;
+	tilew = 1;
+	tileh = 1;
+
+	//Add to the list
+	numero = vcTilemaps.add(this);
+
+	//Read the file
+	string text;
+	if(!xyReadFile(filename, text)){
+		xyPrint(0, "Unable to open map %s!", filename);
+		return;
+	};
+
+	cJSON* root = cJSON_Parse(text.c_str());
+	if(root == 0){
+		xyPrint(0, "Unable to parse map %s!", filename);
+		return;
+	};
+
+	if(cJSON_GetObjectItem(root, "infinite") != 0 && cJSON_GetObjectItem(root, "infinite")->type == cJSON_True){
+		xyPrint(0, "Infinite maps are not supported: %s", filename);
+		cJSON_Delete(root);
+		return;
+	};
+
+	mapw = xyJSONInt(root, "width", 0);
+	maph = xyJSONInt(root, "height", 0);
+	tilew = xyJSONInt(root, "tilewidth", 1);
+	tileh = xyJSONInt(root, "tileheight", 1);
+	if(tilew < 1) tilew = 1;
+	if(tileh < 1) tileh = 1;
+
+	string dir = filename;
+	string::size_type slashnum = dir.find_last_of("/\\");
+	if(slashnum != string::npos) dir = dir.substr(0, slashnum + 1);
+	else dir = "";
+
+	//Tilesets
+	cJSON* sets = cJSON_GetObjectItem(root, "tilesets");
+	if(sets != 0){
+		for(int i = 0; i < cJSON_GetArraySize(sets); i++){
+			addTileset(cJSON_GetArrayItem(sets, i), dir);
+		};
+	};
+
+	//Tile layers
+	cJSON* lays = cJSON_GetObjectItem(root, "layers");
+	if(lays != 0){
+		for(int i = 0; i < cJSON_GetArraySize(lays); i++){
+			cJSON* lay = cJSON_GetArrayItem(lays, i);
+			const char* type = xyJSONString(lay, "type");
+			if(type == 0 || strcmp(type, "tilelayer") != 0) continue;
+
+			xyTileLayer nlayer;
+			const char* lname = xyJSONString(lay, "name");
+			nlayer.name = (lname != 0 ? lname : "");
+			nlayer.w = xyJSONInt(lay, "width", mapw);
+			nlayer.h = xyJSONInt(lay, "height", maph);
+			nlayer.ox = xyJSONInt(lay, "offsetx", 0);
+			nlayer.oy = xyJSONInt(lay, "offsety", 0);
+			cJSON* vis = cJSON_GetObjectItem(lay, "visible");
+			nlayer.visible = (vis == 0 || vis->type != cJSON_False);
+			nlayer.tiles.assign(nlayer.w * nlayer.h, 0);
+			nlayer.cached = 0;
+			nlayer.cw = 0;
+			nlayer.ch = 0;
+			nlayer.cols = 0;
+			nlayer.rows = 0;
+
+			cJSON* data = cJSON_GetObjectItem(lay, "data");
+			if(data == 0 || data->type != cJSON_Array){
+				xyPrint(0, "Layer %s in %s is not stored as CSV and will be empty.", nlayer.name.c_str(), filename);
+			} else {
+				//GIDs can use all 32 bits, so read them from the double
+				int n = 0;
+				for(cJSON* gid = data->child; gid != 0 && n < nlayer.tiles.size(); gid = gid->next){
+					nlayer.tiles[n++] = (Uint32)gid->valuedouble;
+				};
+			};
+
+			layers.push_back(nlayer);
+		};
+	};
+
+	cJSON_Delete(root);
+};
+
+xyTilemap::~xyTilemap(){
+	for(int i = 0; i < layers.size(); i++){
+		freeChunks(layers[i]);
+	};
+
+	//Tileset sprites belong to the map
+	for(int i = 0; i < tilesets.size(); i++){
+		xyDeleteSprite(tilesets[i].sprite);
+	};
+
+	//Remove from list
+	vcTilemaps.remove(numero);
+};
+
+//Load an embedded tileset or one saved as a .tsx file
+bool xyTilemap::addTileset(cJSON* ts, const string& dir){
+	xyTileset nset;
+	nset.first = xyJSONInt(ts, "firstgid", 1);
+
+	int margin = 0, spacing = 0;
+	string image;
+
+	const char* source = xyJSONString(ts, "source");
+	if(source != 0){
+		string tsxpath = xyTilePath(dir, source);
+		tinyxml2::XMLDocument doc;
+		string tsx;
+		if(!xyReadFile(tsxpath.c_str(), tsx) || doc.Parse(tsx.c_str(), tsx.size()) != tinyxml2::XML_SUCCESS){
+			xyPrint(0, "Unable to open tileset %s!", tsxpath.c_str());
+			return false;
+		};
+
+		tinyxml2::XMLElement* tset = doc.FirstChildElement("tileset");
+		tinyxml2::XMLElement* timg = (tset != 0 ? tset->FirstChildElement("image") : 0);
+		if(timg == 0 || timg->Attribute("source") == 0){
+			xyPrint(0, "Tileset %s has no image!", tsxpath.c_str());
+			return false;
+		};
+
+		nset.tw = tset->IntAttribute("tilewidth", tilew);
+		nset.th = tset->IntAttribute("tileheight", tileh);
+		nset.count = tset->IntAttribute("tilecount", 0);
+		margin = tset->IntAttribute("margin", 0);
+		spacing = tset->IntAttribute("spacing", 0);
+
+		//The image is relative to the .tsx
+		string tsxdir = tsxpath;
+		string::size_type slashnum = tsxdir.find_last_of("/\\");
+		if(slashnum != string::npos) tsxdir = tsxdir.substr(0, slashnum + 1);
+		else tsxdir = "";
+		image = xyTilePath(tsxdir, timg->Attribute("source"));
+	} else {
+		const char* img = xyJSONString(ts, "image");
+		if(img == 0){
+			xyPrint(0, "Image collection tilesets are not supported.");
+			return false;
+		};
+
+		nset.tw = xyJSONInt(ts, "tilewidth", tilew);
+		nset.th = xyJSONInt(ts, "tileheight", tileh);
+		nset.count = xyJSONInt(ts, "tilecount", 0);
+		margin = xyJSONInt(ts, "margin", 0);
+		spacing = xyJSONInt(ts, "spacing", 0);
+		image = xyTilePath(dir, img);
+	};
+
+	nset.sprite = xyNewSprite(image.c_str(), nset.tw, nset.th, margin, spacing, 0, 0, nset.count);
+	if(nset.count == 0 && vcSprites[nset.sprite] != 0) nset.count = vcSprites[nset.sprite]->getframes();
+
+	tilesets.push_back(nset);
+	return true;
+};
+
+//Find which tileset a GID belongs to
+int xyTilemap::findTileset(Uint32 gid){
+	for(int i = tilesets.size() - 1; i >= 0; i--){
+		if(gid >= tilesets[i].first){
+			if(gid < tilesets[i].first + tilesets[i].count) return i;
+			return -1;
+		};
+	};
+
+	return -1;
+};
+
+Uint32 xyTilemap::getnum(){
+	return numero;
+};
+
+int xyTilemap::findLayer(const char* name){
+	for(int i = 0; i < layers.size(); i++){
+		if(layers[i].name == name) return i;
+	};
+
+	return -1;
+};
+
+Uint32 xyTilemap::getLayers(){
+	return layers.size();
+};
+
+Uint32 xyTilemap::getTile(Uint32 layer, int x, int y){
+	if(layer >= layers.size()) return 0;
+	xyTileLayer& l = layers[layer];
+	if(x < 0 || y < 0 || x >= l.w || y >= l.h) return 0;
+
+	return l.tiles[(y * l.w) + x];
+};
+
+void xyTilemap::setTile(Uint32 layer, int x, int y, Uint32 gid){
+	if(layer >= layers.size()) return;
+	xyTileLayer& l = layers[layer];
+	if(x < 0 || y < 0 || x >= l.w || y >= l.h) return;
+
+	l.tiles[(y * l.w) + x] = gid;
+
+	//Only the chunk holding this cell needs to be redrawn
+	if(l.cached) l.chunks[((y / l.ch) * l.cols) + (x / l.cw)].dirty = 1;
+};
+
+//Tiles taller or wider than the grid hang up and right
+//from their cell the way Tiled draws them. This finds how
+//far the largest ones reach past their cell.
+void xyTilemap::getOverhang(int* overW, int* overH){
+	*overW = 0;
+	*overH = 0;
+	for(int i = 0; i < tilesets.size(); i++){
+		if(tilesets[i].tw - tilew > *overW) *overW = tilesets[i].tw - tilew;
+		if(tilesets[i].th - tileh > *overH) *overH = tilesets[i].th - tileh;
+	};
+};
+
+//Draw the part of a layer that can be seen from the camera
+void xyTilemap::drawLayer(Uint32 layer, int camX, int camY){
+	if(layer >= layers.size()) return;
+	xyTileLayer& l = layers[layer];
+	if(!l.visible) return;
+
+	//Widen the range so overhanging tiles are not culled
+	int overW, overH;
+	getOverhang(&overW, &overH);
+
+	int ox = camX - l.ox;
+	int oy = camY - l.oy;
+
+	//Visible range of cells, or of chunks
+	int sw = tilew, sh = tileh;
+	int cols = l.w, rows = l.h;
+	if(l.cached){
+		sw *= l.cw;
+		sh *= l.ch;
+		cols = l.cols;
+		rows = l.rows;
+	};
+
+	//What the camera sees, if one is set
+	float vx0, vy0, vx1, vy1;
+	xyCameraView(&vx0, &vy0, &vx1, &vy1);
+
+	int x0 = floor((ox + vx0 - overW) / sw);
+	int y0 = floor((oy + vy0) / sh);
+	int x1 = ceil((ox + vx1) / sw);
+	int y1 = ceil((oy + vy1 + overH) / sh);
+	if(x0 < 0) x0 = 0;
+	if(y0 < 0) y0 = 0;
+	if(x1 > cols) x1 = cols;
+	if(y1 > rows) y1 = rows;
+
+	if(!l.cached){
+		drawCells(l, x0, y0, x1, y1, ox, oy);
+		return;
+	};
+
+	for(int y = y0; y < y1; y++){
+		for(int x = x0; x < x1; x++){
+			drawChunk(l, x, y, ox, oy);
+		};
+	};
+};
+
+//Draw a range of cells with the layer's origin at -ox,-oy
+void xyTilemap::drawCells(xyTileLayer& l, int x0, int y0, int x1, int y1, int ox, int oy){
+	SDL_Rect rec;
+	SDL_FRect des;
+	for(int y = y0; y < y1; y++){
+		const Uint32* row = &l.tiles[y * l.w];
+		for(int x = x0; x < x1; x++){
+			Uint32 raw = row[x];
+			Uint32 gid = raw & _TGID;
+			if(gid == 0) continue;
+
+			int ts = findTileset(gid);
+			if(ts == -1) continue;
+			xyTileset& set = tilesets[ts];
+			xySprite* spr = vcSprites[set.sprite];
+			if(spr == 0) continue;
+
+			spr->getFrame(gid - set.first, &rec);
+			des.x = (x * tilew) - ox;
+			des.y = (y * tileh) - oy + tileh - set.th;
+			des.w = set.tw;
+			des.h = set.th;
+
+			SDL_Texture* tex = vcTextures[spr->gettex()];
+			if((raw & (_TFH | _TFV | _TFD)) == 0){
+				xyBatchQuad(tex, &rec, &des);
+				continue;
+			};
+
+			//Turn Tiled's flags into a flip plus a quarter turn
+			//around the middle of the tile
+			int flip = SDL_FLIP_NONE;
+			double angle = 0;
+			bool fh = raw & _TFH;
+			bool fv = raw & _TFV;
+			if(raw & _TFD){
+				angle = 90;
+				if(fh && fv) flip = SDL_FLIP_HORIZONTAL;
+				else if(fv) angle = 270;
+				else if(!fh) flip = SDL_FLIP_VERTICAL;
+			} else {
+				if(fh) flip |= SDL_FLIP_HORIZONTAL;
+				if(fv) flip |= SDL_FLIP_VERTICAL;
+			};
+
+			xyBatchQuadEx(tex, &rec, &des, angle, 0, (SDL_RendererFlip)flip);
+		};
+	};
+};
+
+/////////////////
+// CHUNK CACHE //
+////////////////{
+
+//Give a chunk a w*h target texture. When that would go
+//over budget, the least recently drawn chunks are evicted
+//first, and a texture of the right size is taken over
+//instead of being destroyed. Returns 0 if nothing can be
+//evicted because every chunk is on screen.
+static SDL_Texture* xyChunkTexture(xyTileChunk* chunk, int w, int h){
+	Uint32 need = w * h * 4;
+	SDL_Texture* tex = 0;
+
+	while(tex == 0 && chunkBytes + need > gvChunkBudget){
+		int lru = -1;
+		for(int i = 0; i < vcChunks.size(); i++){
+			if(vcChunks[i]->used == gvFrame) continue;
+			if(lru == -1 || vcChunks[i]->used < vcChunks[lru]->used) lru = i;
+		};
+		if(lru == -1) return 0;
+
+		xyTileChunk* old = vcChunks[lru];
+		vcChunks.erase(vcChunks.begin() + lru);
+
+		int ow = 0, oh = 0;
+		SDL_QueryTexture(old->tex, 0, 0, &ow, &oh);
+		xyBatchForget(old->tex);
+		if(ow == w && oh == h) tex = old->tex;
+		else {
+			xyStateForget(old->tex);
+			SDL_DestroyTexture(old->tex);
+			chunkBytes -= ow * oh * 4;
+		};
+
+		old->tex = 0;
+		old->dirty = 1;
+	};
+
+	if(tex == 0){
+		tex = SDL_CreateTexture(gvRender, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+		if(tex == 0){
+			xyPrint(0, "Unable to create tile chunk! SDL Error: %s\n", SDL_GetError());
+			return 0;
+		};
+		chunkBytes += need;
+	};
+
+	chunk->tex = tex;
+	vcChunks.push_back(chunk);
+	return tex;
+};
+
+//Draw one chunk, rendering it first if it changed
+void xyTilemap::drawChunk(xyTileLayer& l, int cx, int cy, int ox, int oy){
+	xyTileChunk& c = l.chunks[(cy * l.cols) + cx];
+
+	int overW, overH;
+	getOverhang(&overW, &overH);
+
+	//Cells covered by this chunk
+	int x0 = cx * l.cw;
+	int y0 = cy * l.ch;
+	int x1 = min(x0 + l.cw, (int)l.w);
+	int y1 = min(y0 + l.ch, (int)l.h);
+
+	//The texture has room for tiles hanging out of it
+	int px = x0 * tilew;
+	int py = (y0 * tileh) - overH;
+	int pw = (l.cw * tilew) + overW;
+	int ph = (l.ch * tileh) + overH;
+
+	c.used = gvFrame;
+	if(c.tex == 0 && xyChunkTexture(&c, pw, ph) == 0){
+		//No room, so draw it the slow way
+		drawCells(l, x0, y0, x1, y1, ox, oy);
+		return;
+	};
+
+	if(c.dirty){
+		//Whatever blend mode the script is using is for
+		//drawing the chunk, not for the tiles inside it
+		SDL_BlendMode blend = xyBatchGetBlend();
+		xyPushDrawTarget(c.tex);
+		xyBatchSetBlend(SDL_BLENDMODE_BLEND);
+
+		//Start from a transparent chunk
+		xyStateClear(0, 0, 0, 0);
+
+		drawCells(l, x0, y0, x1, y1, px, py);
+		xyPopDrawTarget();
+		xyBatchSetBlend(blend);
+		c.dirty = 0;
+	};
+
+	SDL_FRect des;
+	des.x = px - ox;
+	des.y = py - oy;
+	des.w = pw;
+	des.h = ph;
+	xyBatchBaked(c.tex, &des);
+};
+
+//Drop a layer's chunk textures
+void xyTilemap::freeChunks(xyTileLayer& l){
+	for(int i = 0; i < l.chunks.size(); i++){
+		xyTileChunk* c = &l.chunks[i];
+		if(c->tex == 0) continue;
+
+		for(int j = 0; j < vcChunks.size(); j++){
+			if(vcChunks[j] == c){
+				vcChunks.erase(vcChunks.begin() + j);
+				break;
+			};
+		};
+
+		int w = 0, h = 0;
+		SDL_QueryTexture(c->tex, 0, 0, &w, &h);
+		xyBatchForget(c->tex);
+		xyStateForget(c->tex);
+		SDL_DestroyTexture(c->tex);
+		chunkBytes -= w * h * 4;
+		c->tex = 0;
+	};
+};
+
+//Turn chunk caching on or off for a layer. Only
+//layers that rarely change should be cached.
+void xyTilemap::setCached(Uint32 layer, bool cache){
+	if(layer >= layers.size()) return;
+	xyTileLayer& l = layers[layer];
+	if(cache == l.cached) return;
+
+	if(!cache){
+		freeChunks(l);
+		l.chunks.clear();
+		l.cached = 0;
+		return;
+	};
+
+	l.cw = max(1, _TCHUNK / tilew);
+	l.ch = max(1, _TCHUNK / tileh);
+	l.cols = (l.w + l.cw - 1) / l.cw;
+	l.rows = (l.h + l.ch - 1) / l.ch;
+
+	xyTileChunk blank;
+	blank.tex = 0;
+	blank.dirty = 1;
+	blank.used = 0;
+	l.chunks.assign(l.cols * l.rows, blank);
+	l.cached = 1;
+};
+
+//Redraw every chunk the next time it is needed
+void xyTilemap::invalidate(){
+	for(int i = 0; i < layers.size(); i++){
+		for(int j = 0; j < layers[i].chunks.size(); j++){
+			layers[i].chunks[j].dirty = 1;
+		};
+	};
+};
+
+//Render targets can be wiped by the driver,
+//so every map has to redraw its chunks
+void xyTilemapInvalidate(){
+	for(Uint32 i = 1; i < vcTilemaps.slots(); i++){
+		xyTilemap* m = vcTilemaps[vcTilemaps.handleAt(i)];
+		if(m != 0) m->invalidate();
+	};
+};
+
+//}
@@ -0,0 +1,74 @@
+/*==============*\
+| TILEMAP HEADER |
+\*==============*/
+
+#ifndef _TILEMAP_H_
+#define _TILEMAP_H_
+
+//Tiled uses the top bits of a GID for flipping
+const Uint32 _TFH = 0x80000000; //Flipped horizontally
+const Uint32 _TFV = 0x40000000; //Flipped vertically
+const Uint32 _TFD = 0x20000000; //Flipped diagonally
+const Uint32 _TGID = 0x1FFFFFFF; //Mask for the GID itself
+
+struct xyTileset{
+	Uint32 first;	//First GID
+	Uint32 count;	//Number of tiles
+	Uint32 sprite;	//Handle in vcSprites
+	int tw, th;		//Tile size, which can differ from the map's
+};
+
+//Static layers can be cached in chunks of
+//about 256x256 pixels, each rendered once
+//into its own target texture
+const int _TCHUNK = 256;
+
+struct xyTileChunk{
+	SDL_Texture* tex;	//0 while not resident
+	bool dirty;			//Needs to be drawn again
+	Uint32 used;		//Last frame it was drawn
+};
+
+struct xyTileLayer{
+	string name;
+	Uint32 w, h;
+	int ox, oy;				//Layer offset in pixels
+	bool visible;
+	vector<Uint32> tiles;	//GIDs with flip flags, row by row
+	bool cached;			//Drawn from chunk textures
+	int cw, ch;				//Chunk size in cells
+	int cols, rows;			//Number of chunks
+	vector<xyTileChunk> chunks;
+};
+
+extern Uint32 gvChunkBudget;	//Bytes of VRAM tile chunks may use
+
+class xyTilemap{
+private:
+	Uint32 numero;
+	Uint32 mapw, maph;	//Size in tiles
+	int tilew, tileh;	//Grid size in pixels
+	vector<xyTileset> tilesets;
+	vector<xyTileLayer> layers;
+	bool addTileset(cJSON* ts, const string& dir);
+	int findTileset(Uint32 gid);
+	void getOverhang(int* overW, int* overH);
+	void drawCells(xyTileLayer& l, int x0, int y0, int x1, int y1, int ox, int oy);
+	void drawChunk(xyTileLayer& l, int cx, int cy, int ox, int oy);
+	void freeChunks(xyTileLayer& l);
+public:
+	xyTilemap(const char* filename);
+	~xyTilemap();
+	Uint32 getnum();
+	int findLayer(const char* name);
+	Uint32 getLayers();
+	Uint32 getTile(Uint32 layer, int x, int y);
+	void setTile(Uint32 layer, int x, int y, Uint32 gid);
+	void drawLayer(Uint32 layer, int camX, int camY);
+	void setCached(Uint32 layer, bool cache);
+	void invalidate();
+};
+
+void xyTilemapInvalidate();
+
+#endif